@@ -0,0 +1,14 @@
+#ifndef ARNELIFY_BROKER_CALL_HPP
+#define ARNELIFY_BROKER_CALL_HPP
+
+#include <iostream>
+
+#include "json.h"
+
+/* One of the calls a broker fans out at once. */
+struct BrokerCall {
+  std::string topic;
+  Json::Value params;
+};
+
+#endif
\ No newline at end of file
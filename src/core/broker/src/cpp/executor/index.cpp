@@ -0,0 +1,126 @@
+#ifndef ARNELIFY_BROKER_EXECUTOR_CPP
+#define ARNELIFY_BROKER_EXECUTOR_CPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Threads shared by the asynchronous calls of a broker, started by the
+   first task. A task that no thread has taken yet is run by the thread
+   that waits for it instead, so a call waiting for the calls it fanned
+   out keeps going even when every thread of the executor is busy. */
+class ArnelifyBrokerExecutor final {
+ public:
+  struct Task {
+    std::atomic<bool> isTaken = false;
+    std::function<void()> run;
+    std::promise<void> promise;
+    std::shared_future<void> future;
+  };
+
+  using TaskPtr = std::shared_ptr<Task>;
+
+ private:
+  bool isRunning;
+  int threadLimit;
+  std::mutex mtx;
+  std::condition_variable isEmpty;
+  std::deque<TaskPtr> tasks;
+  std::vector<std::thread> threads;
+
+  static bool &isWorkerThread() {
+    thread_local bool isWorker = false;
+    return isWorker;
+  }
+
+  /* Runs the task unless another thread took it first. */
+  static void execute(const TaskPtr &task) {
+    const bool isTaken = task->isTaken.exchange(true);
+    if (isTaken) return;
+
+    try {
+      task->run();
+      task->promise.set_value();
+    } catch (...) {
+      task->promise.set_exception(std::current_exception());
+    }
+  }
+
+  void worker() {
+    isWorkerThread() = true;
+    while (true) {
+      std::unique_lock<std::mutex> lock(this->mtx);
+      this->isEmpty.wait(lock, [this]() {
+        return !this->isRunning || !this->tasks.empty();
+      });
+
+      if (this->tasks.empty()) return;
+      const TaskPtr task = std::move(this->tasks.front());
+      this->tasks.pop_front();
+      lock.unlock();
+
+      execute(task);
+    }
+  }
+
+ public:
+  /* Without a thread limit there is a thread per core, and at least
+     four, as actions mostly wait on I/O rather than compute. */
+  ArnelifyBrokerExecutor(const int &t = 0) : isRunning(true), threadLimit(t) {
+    if (this->threadLimit > 0) return;
+
+    const int cores = std::thread::hardware_concurrency();
+    this->threadLimit = std::max(cores, 4);
+  }
+
+  ~ArnelifyBrokerExecutor() {
+    {
+      std::lock_guard<std::mutex> lock(this->mtx);
+      this->isRunning = false;
+    }
+
+    this->isEmpty.notify_all();
+    for (std::thread &thread : this->threads) thread.join();
+  }
+
+  /* True on the threads of an executor. */
+  static bool isWorker() { return isWorkerThread(); }
+
+  TaskPtr post(const std::function<void()> &run) {
+    TaskPtr task = std::make_shared<Task>();
+    task->run = run;
+    task->future = task->promise.get_future().share();
+
+    {
+      std::lock_guard<std::mutex> lock(this->mtx);
+      if (this->threads.empty()) {
+        this->threads.reserve(this->threadLimit);
+        for (int i = 0; this->threadLimit > i; ++i) {
+          this->threads.emplace_back([this]() { this->worker(); });
+        }
+      }
+
+      this->tasks.push_back(task);
+    }
+
+    this->isEmpty.notify_one();
+    return task;
+  }
+
+  /* Waits for a task, running it here if no thread has taken it yet, and
+     rethrows what it threw. */
+  void wait(const TaskPtr &task) {
+    execute(task);
+    task->future.get();
+  }
+};
+
+#endif
\ No newline at end of file
@@ -1,38 +1,58 @@
 #ifndef ARNELIFY_BROKER_CPP
 #define ARNELIFY_BROKER_CPP
 
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <future>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <random>
 #include <sstream>
 #include <vector>
 
 #include "json.h"
 
+#include "executor/index.cpp"
 #include "serializer/index.cpp"
 
 #include "contracts/action.hpp"
+#include "contracts/call.hpp"
 #include "contracts/callback.hpp"
 #include "contracts/ctx.hpp"
 
+/* Calls run on the thread that makes them; callAsync() and callAll() hand
+   them to an executor shared by the calls of the broker. In local mode a
+   topic subscribed in this process gets its ctx as a Json::Value, and
+   only other topics go through serialized messages. */
 class ArnelifyBroker {
  private:
-  std::map<const std::string, BrokerAction> actions;
+  const bool isLocal;
+  using ActionPtr = std::shared_ptr<const BrokerAction>;
+
+  std::mutex mtx;
+  /* Guards actions and req, which calls read while subscribe() writes. */
+  std::shared_mutex topicsMtx;
+  std::map<const std::string, ActionPtr> actions;
   std::map<const std::string, BrokerRequest> req;
   std::map<const std::string, BrokerResponse> res;
+  /* Last, so its threads are joined before the maps they use go. */
+  ArnelifyBrokerExecutor executor;
 
   void consumer(const std::string& topic,
                 std::function<void(const std::string&)> onMessage) {
+    std::unique_lock<std::shared_mutex> lock(this->topicsMtx);
     this->req[topic] = onMessage;
   };
 
   const Json::Value handler(const std::string& topic, Json::Value& ctx) {
     ctx["receivedAt"] = this->getDateTime();
-    const BrokerAction& action = this->actions[topic];
+    const ActionPtr action = this->getAction(topic);
     Json::Value res = Json::objectValue;
-    res["content"] = action(ctx);
+    res["content"] = (*action)(ctx);
     res["createdAt"] = ctx["createdAt"];
     res["receivedAt"] = this->getDateTime();
     res["topic"] = ctx["topic"];
@@ -41,67 +61,183 @@ class ArnelifyBroker {
   }
 
   void producer(const std::string& topic, const std::string& message) {
-    const BrokerRequest onMessage = this->req[topic];
+    BrokerRequest onMessage;
+    {
+      std::shared_lock<std::shared_mutex> lock(this->topicsMtx);
+      auto it = this->req.find(topic);
+      if (it != this->req.end()) onMessage = it->second;
+    }
+
     onMessage(message);
   };
 
   void receive(const Json::Value& res) {
     const std::string uuid = res["uuid"].asString();
-    const BrokerResponse resolve = this->res[uuid];
+    std::unique_lock<std::mutex> lock(this->mtx);
+    const BrokerResponse resolve = std::move(this->res[uuid]);
     this->res.erase(uuid);
+    lock.unlock();
+
     resolve(res["content"]);
   }
 
+  /* Sends the request and waits for its response. Topics subscribed in
+     this process answer before the producer returns. */
   const Json::Value send(
       const std::string& topic, const Json::Value& params,
       const std::function<void(const std::string&)> producer) {
     std::promise<Json::Value> promise;
     std::future<Json::Value> future = promise.get_future();
-    std::thread thread(
-        [this, &topic, &params, &producer](std::promise<Json::Value>& promise) {
-          const std::string uuid = this->getUuId();
-          this->res[uuid] = [&promise](const Json::Value& res) {
-            promise.set_value(res);
-          };
-
-          Ctx ctx = Json::objectValue;
-          ctx["topic"] = topic;
-          ctx["createdAt"] = this->getDateTime();
-          ctx["receivedAt"] = Json::nullValue;
-          ctx["params"] = params;
-          ctx["uuid"] = uuid;
-
-          const std::string message = Serializer::serialize(ctx);
-          producer(message);
-        },
-        std::ref(promise));
-
-    Json::Value response = future.get();
-    thread.join();
-
-    return response;
+    const std::string uuid = this->getUuId();
+    {
+      std::lock_guard<std::mutex> lock(this->mtx);
+      this->res[uuid] = [&promise](const Json::Value& res) {
+        promise.set_value(res);
+      };
+    }
+
+    Ctx ctx = Json::objectValue;
+    ctx["topic"] = topic;
+    ctx["createdAt"] = this->getDateTime();
+    ctx["receivedAt"] = Json::nullValue;
+    ctx["params"] = params;
+    ctx["uuid"] = uuid;
+
+    const std::string message = Serializer::serialize(ctx);
+    try {
+      producer(message);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(this->mtx);
+      this->res.erase(uuid);
+      throw;
+    }
+
+    return future.get();
   }
 
- public:
-  Json::Value call(const std::string& topic, const Json::Value& params) {
+  /* Calls a local action with a ctx "params" is moved into, as the
+     request would have arrived right away. */
+  Json::Value dispatch(const std::string& topic, const BrokerAction& action,
+                       Json::Value&& params) {
+    Ctx ctx = Json::objectValue;
+    ctx["topic"] = topic;
+    ctx["createdAt"] = this->getDateTime();
+    ctx["receivedAt"] = ctx["createdAt"];
+    ctx["params"] = std::move(params);
+    ctx["uuid"] = this->getUuId();
+    return action(ctx);
+  }
+
+  /* Action of a topic subscribed in this process, or nullptr. A call
+     keeps the action it got even if the topic is subscribed again. */
+  ActionPtr getAction(const std::string& topic) {
+    std::shared_lock<std::shared_mutex> lock(this->topicsMtx);
+    auto it = this->actions.find(topic);
+    const bool hasAction = it != this->actions.end();
+    return hasAction ? it->second : nullptr;
+  }
+
+  Json::Value request(const std::string& topic, const Json::Value& params) {
     return this->send(topic, params, [this, topic](const std::string& message) {
       this->producer(topic + ":req", message);
     });
   }
 
+ public:
+  ArnelifyBroker(const bool& l = true) : isLocal(l) {}
+
+  Json::Value call(const std::string& topic, const Json::Value& params) {
+    const ActionPtr action = this->isLocal ? this->getAction(topic) : nullptr;
+    if (!action) return this->request(topic, params);
+    return this->dispatch(topic, *action, Json::Value(params));
+  }
+
+  /* Moves "params" into the ctx of a local action instead of copying. */
+  Json::Value call(const std::string& topic, Json::Value&& params) {
+    const ActionPtr action = this->isLocal ? this->getAction(topic) : nullptr;
+    if (!action) return this->request(topic, params);
+    return this->dispatch(topic, *action, std::move(params));
+  }
+
+  /* Runs the call on the executor. On a thread of the executor it runs
+     right away instead, as waiting there for a queued call could take
+     the last thread it needs. */
+  std::future<Json::Value> callAsync(const std::string& topic,
+                                     const Json::Value& params) {
+    const std::shared_ptr<std::promise<Json::Value>> promise =
+        std::make_shared<std::promise<Json::Value>>();
+    std::future<Json::Value> future = promise->get_future();
+    std::function<void()> run = [this, topic, params, promise]() mutable {
+      try {
+        promise->set_value(this->call(topic, std::move(params)));
+      } catch (...) {
+        promise->set_exception(std::current_exception());
+      }
+    };
+
+    if (ArnelifyBrokerExecutor::isWorker()) {
+      run();
+      return future;
+    }
+
+    this->executor.post(run);
+    return future;
+  }
+
+  /* Makes the calls at once and returns their responses in order. The
+     first one runs here while the executor takes the others; any it
+     hasn't started by then run here too. */
+  std::vector<Json::Value> callAll(const std::vector<BrokerCall>& calls) {
+    std::vector<Json::Value> responses(calls.size());
+    std::vector<ArnelifyBrokerExecutor::TaskPtr> tasks;
+    tasks.reserve(calls.size());
+    for (std::size_t i = 1; i < calls.size(); ++i) {
+      tasks.push_back(this->executor.post([this, &calls, &responses, i]() {
+        responses[i] = this->call(calls[i].topic, calls[i].params);
+      }));
+    }
+
+    std::exception_ptr error;
+    try {
+      if (!calls.empty()) {
+        responses[0] = this->call(calls[0].topic, calls[0].params);
+      }
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    for (const ArnelifyBrokerExecutor::TaskPtr& task : tasks) {
+      try {
+        this->executor.wait(task);
+      } catch (...) {
+        if (!error) error = std::current_exception();
+      }
+    }
+
+    if (error) std::rethrow_exception(error);
+    return responses;
+  }
+
+  /* The string only changes once a second, so each thread formats it
+     once a second. */
   const std::string getDateTime() {
+    thread_local std::time_t formattedAt = -1;
+    thread_local std::string dateTime;
     const auto now = std::chrono::system_clock::now();
     const std::time_t now_c = std::chrono::system_clock::to_time_t(now);
-    const std::tm local_time = *std::localtime(&now_c);
+    if (now_c == formattedAt) return dateTime;
 
+    std::tm local_time;
+    localtime_r(&now_c, &local_time);
     std::ostringstream oss;
     oss << std::put_time(&local_time, "%Y-%m-%d %H:%M:%S");
-    return oss.str();
+    dateTime = oss.str();
+    formattedAt = now_c;
+    return dateTime;
   }
 
   const std::string getUuId() {
-    std::random_device rd;
-    std::mt19937 gen(rd());
+    thread_local std::mt19937 gen(std::random_device{}());
     std::uniform_int_distribution<> dis(10000, 19999);
     int random = dis(gen);
     const auto now = std::chrono::system_clock::now();
@@ -110,7 +246,12 @@ class ArnelifyBroker {
             now.time_since_epoch())
             .count();
 
-    const std::string code = std::to_string(milliseconds) + std::to_string(random);
+    /* Calls made within the same millisecond are told apart by the
+       counter, as ids of pending calls must not collide. */
+    static std::atomic<std::uint64_t> counter(0);
+    const std::string code = std::to_string(milliseconds) +
+                             std::to_string(random) +
+                             std::to_string(counter++);
     std::hash<std::string> hasher;
     size_t v1 = hasher(code);
     size_t v2 = hasher(std::to_string(v1));
@@ -130,7 +271,10 @@ class ArnelifyBroker {
   }
 
   void subscribe(const std::string& topic, const BrokerAction& action) {
-    this->actions[topic] = action;
+    {
+      std::unique_lock<std::shared_mutex> lock(this->topicsMtx);
+      this->actions[topic] = std::make_shared<const BrokerAction>(action);
+    }
 
     this->consumer(topic + ":res", [this, topic](const std::string& message) {
       const Json::Value res = Serializer::deserialize(message);
@@ -6,21 +6,37 @@
 #include <functional>
 #include <future>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <stdexcept>
 
 #include "json.h"
 
+#include "cpp/executor/index.cpp"
+
 #include "cpp/contracts/action.hpp"
+#include "cpp/contracts/call.hpp"
 #include "cpp/contracts/callback.hpp"
 #include "cpp/contracts/ctx.hpp"
 
+/* In local mode a topic subscribed in this process gets its ctx as a
+   Json::Value, and only other topics go through serialized messages. */
 class ArnelifyBroker {
  private:
+  const bool isLocal;
   void* lib = nullptr;
   std::filesystem::path libPath;
-  std::map<const std::string, BrokerAction> actions;
+  using ActionPtr = std::shared_ptr<const BrokerAction>;
+
+  std::mutex mtx;
+  /* Guards actions and req, which calls read while subscribe() writes. */
+  std::shared_mutex topicsMtx;
+  std::map<const std::string, ActionPtr> actions;
   std::map<const std::string, BrokerRequest> req;
   std::map<const std::string, BrokerResponse> res;
+  /* Last, so its threads are joined before the maps they use go. */
+  ArnelifyBrokerExecutor executor;
 
   const char* (*broker_get_datetime)();
   const char* (*broker_get_uuid)();
@@ -45,9 +61,9 @@ class ArnelifyBroker {
 
   const Json::Value handler(const std::string& topic, Json::Value& ctx) {
     ctx["receivedAt"] = this->getDateTime();
-    const BrokerAction& action = this->actions[topic];
+    const ActionPtr action = this->getAction(topic);
     Json::Value res = Json::objectValue;
-    res["content"] = action(ctx);
+    res["content"] = (*action)(ctx);
     res["createdAt"] = ctx["createdAt"];
     res["receivedAt"] = this->getDateTime();
     res["topic"] = ctx["topic"];
@@ -57,39 +73,74 @@ class ArnelifyBroker {
 
   void receive(const Json::Value& res) {
     const std::string uuid = res["uuid"].asString();
-    const BrokerResponse resolve = this->res[uuid];
+    std::unique_lock<std::mutex> lock(this->mtx);
+    const BrokerResponse resolve = std::move(this->res[uuid]);
     this->res.erase(uuid);
+    lock.unlock();
+
     resolve(res["content"]);
   }
 
+  /* Sends the request and waits for its response. Topics subscribed in
+     this process answer before the producer returns. */
   const Json::Value send(
       const std::string& topic, const Json::Value& params,
       const std::function<void(const std::string&)> producer) {
     std::promise<Json::Value> promise;
     std::future<Json::Value> future = promise.get_future();
-    std::thread thread(
-        [this, &topic, &params, &producer](std::promise<Json::Value>& promise) {
-          const std::string uuid = this->getUuid();
-          this->res[uuid] = [&promise](const Json::Value& res) {
-            promise.set_value(res);
-          };
+    const std::string uuid = this->getUuid();
+    {
+      std::lock_guard<std::mutex> lock(this->mtx);
+      this->res[uuid] = [&promise](const Json::Value& res) {
+        promise.set_value(res);
+      };
+    }
 
-          Ctx ctx = Json::objectValue;
-          ctx["topic"] = topic;
-          ctx["createdAt"] = this->getDateTime();
-          ctx["receivedAt"] = Json::nullValue;
-          ctx["params"] = params;
-          ctx["uuid"] = uuid;
+    Ctx ctx = Json::objectValue;
+    ctx["topic"] = topic;
+    ctx["createdAt"] = this->getDateTime();
+    ctx["receivedAt"] = Json::nullValue;
+    ctx["params"] = params;
+    ctx["uuid"] = uuid;
+
+    const std::string message = this->serialize(ctx);
+    try {
+      producer(message);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(this->mtx);
+      this->res.erase(uuid);
+      throw;
+    }
 
-          const std::string message = this->serialize(ctx);
-          producer(message);
-        },
-        std::ref(promise));
+    return future.get();
+  }
+
+  /* Calls a local action with a ctx "params" is moved into, as the
+     request would have arrived right away. */
+  Json::Value dispatch(const std::string& topic, const BrokerAction& action,
+                       Json::Value&& params) {
+    Ctx ctx = Json::objectValue;
+    ctx["topic"] = topic;
+    ctx["createdAt"] = this->getDateTime();
+    ctx["receivedAt"] = ctx["createdAt"];
+    ctx["params"] = std::move(params);
+    ctx["uuid"] = this->getUuid();
+    return action(ctx);
+  }
 
-    Json::Value response = future.get();
-    thread.join();
+  /* Action of a topic subscribed in this process, or nullptr. A call
+     keeps the action it got even if the topic is subscribed again. */
+  ActionPtr getAction(const std::string& topic) {
+    std::shared_lock<std::shared_mutex> lock(this->topicsMtx);
+    auto it = this->actions.find(topic);
+    const bool hasAction = it != this->actions.end();
+    return hasAction ? it->second : nullptr;
+  }
 
-    return response;
+  Json::Value request(const std::string& topic, const Json::Value& params) {
+    return this->send(topic, params, [this, topic](const std::string& message) {
+      this->producer(topic + ":req", message);
+    });
   }
 
   const std::string getLibPath() {
@@ -138,7 +189,7 @@ class ArnelifyBroker {
   }
 
  public:
-  ArnelifyBroker() {
+  ArnelifyBroker(const bool& l = true) : isLocal(l) {
     const std::string libPath = this->getLibPath();
     this->lib = dlopen(libPath.c_str(), RTLD_LAZY);
     if (!this->lib) throw std::runtime_error(dlerror());
@@ -151,13 +202,80 @@ class ArnelifyBroker {
   }
 
   Json::Value call(const std::string& topic, const Json::Value& params) {
-    return this->send(topic, params, [this, topic](const std::string& message) {
-      this->producer(topic + ":req", message);
-    });
+    const ActionPtr action = this->isLocal ? this->getAction(topic) : nullptr;
+    if (!action) return this->request(topic, params);
+    return this->dispatch(topic, *action, Json::Value(params));
+  }
+
+  /* Moves "params" into the ctx of a local action instead of copying. */
+  Json::Value call(const std::string& topic, Json::Value&& params) {
+    const ActionPtr action = this->isLocal ? this->getAction(topic) : nullptr;
+    if (!action) return this->request(topic, params);
+    return this->dispatch(topic, *action, std::move(params));
+  }
+
+  /* Runs the call on the executor. On a thread of the executor it runs
+     right away instead, as waiting there for a queued call could take
+     the last thread it needs. */
+  std::future<Json::Value> callAsync(const std::string& topic,
+                                     const Json::Value& params) {
+    const std::shared_ptr<std::promise<Json::Value>> promise =
+        std::make_shared<std::promise<Json::Value>>();
+    std::future<Json::Value> future = promise->get_future();
+    std::function<void()> run = [this, topic, params, promise]() mutable {
+      try {
+        promise->set_value(this->call(topic, std::move(params)));
+      } catch (...) {
+        promise->set_exception(std::current_exception());
+      }
+    };
+
+    if (ArnelifyBrokerExecutor::isWorker()) {
+      run();
+      return future;
+    }
+
+    this->executor.post(run);
+    return future;
+  }
+
+  /* Makes the calls at once and returns their responses in order. The
+     first one runs here while the executor takes the others; any it
+     hasn't started by then run here too. */
+  std::vector<Json::Value> callAll(const std::vector<BrokerCall>& calls) {
+    std::vector<Json::Value> responses(calls.size());
+    std::vector<ArnelifyBrokerExecutor::TaskPtr> tasks;
+    tasks.reserve(calls.size());
+    for (std::size_t i = 1; i < calls.size(); ++i) {
+      tasks.push_back(this->executor.post([this, &calls, &responses, i]() {
+        responses[i] = this->call(calls[i].topic, calls[i].params);
+      }));
+    }
+
+    std::exception_ptr error;
+    try {
+      if (!calls.empty()) {
+        responses[0] = this->call(calls[0].topic, calls[0].params);
+      }
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    for (const ArnelifyBrokerExecutor::TaskPtr& task : tasks) {
+      try {
+        this->executor.wait(task);
+      } catch (...) {
+        if (!error) error = std::current_exception();
+      }
+    }
+
+    if (error) std::rethrow_exception(error);
+    return responses;
   }
 
   void consumer(const std::string& topic,
                 std::function<void(const std::string&)> onMessage) {
+    std::unique_lock<std::shared_mutex> lock(this->topicsMtx);
     this->req[topic] = onMessage;
   };
 
@@ -181,7 +299,13 @@ class ArnelifyBroker {
   }
 
   void producer(const std::string& topic, const std::string& message) {
-    const BrokerRequest onMessage = this->req[topic];
+    BrokerRequest onMessage;
+    {
+      std::shared_lock<std::shared_mutex> lock(this->topicsMtx);
+      auto it = this->req.find(topic);
+      if (it != this->req.end()) onMessage = it->second;
+    }
+
     onMessage(message);
   };
 
@@ -198,7 +322,10 @@ class ArnelifyBroker {
   }
 
   void subscribe(const std::string& topic, const BrokerAction& action) {
-    this->actions[topic] = action;
+    {
+      std::unique_lock<std::shared_mutex> lock(this->topicsMtx);
+      this->actions[topic] = std::make_shared<const BrokerAction>(action);
+    }
 
     this->consumer(topic + ":res", [this, topic](const std::string& message) {
       const Json::Value res = this->deserialize(message);
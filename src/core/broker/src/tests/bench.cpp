@@ -0,0 +1,261 @@
+#ifndef ARNELIFY_BROKER_BENCH_CPP
+#define ARNELIFY_BROKER_BENCH_CPP
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "json.h"
+
+#include "../cpp/index.cpp"
+
+void expect(const bool isTrue, const std::string& message) {
+  if (isTrue) return;
+  std::cout << "Broker: " << message << std::endl;
+  exit(1);
+}
+
+/* The First -> Second chain of the app: "first.welcome" asks
+   "second.welcome" for the sum of the numbers it was called with. */
+void subscribe(ArnelifyBroker& broker) {
+  broker.subscribe("second.welcome", [](const Ctx& ctx) -> Json::Value {
+    int sum = 0;
+    for (const Json::Value& number : ctx["params"]["numbers"]) {
+      sum += number.asInt();
+    }
+
+    Json::Value res;
+    res["code"] = 200;
+    res["success"]["response"] = sum;
+    return res;
+  });
+
+  broker.subscribe("first.welcome", [&broker](const Ctx& ctx) -> Json::Value {
+    const Json::Value res = broker.call("second.welcome", ctx["params"]);
+    return res["success"]["response"];
+  });
+
+  broker.subscribe("wait", [](const Ctx& ctx) -> Json::Value {
+    const int ms = ctx["params"]["ms"].asInt();
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    return ctx["params"]["id"];
+  });
+
+  broker.subscribe("ctx", [](const Ctx& ctx) -> Json::Value {
+    Json::Value res;
+    for (const char* key : {"createdAt", "receivedAt", "topic", "uuid"}) {
+      res[key] = ctx[key].isString() && !ctx[key].asString().empty();
+    }
+
+    res["params"] = ctx["params"];
+    return res;
+  });
+
+  broker.subscribe("fail", [](const Ctx& ctx) -> Json::Value {
+    throw std::runtime_error("fail");
+  });
+
+  /* Fans out from inside an action, which runs on the executor when it
+     was called with callAsync() or callAll(). */
+  broker.subscribe("fan", [&broker](const Ctx& ctx) -> Json::Value {
+    std::vector<BrokerCall> calls;
+    for (int i = 0; i < 8; ++i) {
+      Json::Value params;
+      params["id"] = i;
+      params["ms"] = 1;
+      calls.push_back({"wait", params});
+    }
+
+    int sum = 0;
+    for (const Json::Value& res : broker.callAll(calls)) sum += res.asInt();
+    return sum;
+  });
+}
+
+Json::Value getNumbers(const int& seed) {
+  Json::Value params;
+  for (int i = 0; i < 4; ++i) params["numbers"].append(seed + i);
+  return params;
+}
+
+/* Both modes give actions the same ctx and callers the same responses. */
+void checkBroker(const bool& isLocal) {
+  ArnelifyBroker broker(isLocal);
+  subscribe(broker);
+
+  Json::Value params = getNumbers(3);
+  const Json::Value ctx = broker.call("ctx", std::move(params));
+  for (const char* key : {"createdAt", "receivedAt", "topic", "uuid"}) {
+    expect(ctx[key].asBool(), std::string("the ctx has no ") + key);
+  }
+
+  expect(ctx["params"] == getNumbers(3), "the params changed on their way");
+
+  expect(broker.call("first.welcome", getNumbers(1)).asInt() == 10,
+         "the chain returned a wrong sum");
+  expect(broker.callAsync("first.welcome", getNumbers(2)).get() == 14,
+         "an asynchronous call returned a wrong sum");
+
+  std::vector<BrokerCall> calls;
+  for (int i = 0; i < 16; ++i) {
+    calls.push_back({"first.welcome", getNumbers(i)});
+  }
+
+  const std::vector<Json::Value> responses = broker.callAll(calls);
+  for (int i = 0; i < 16; ++i) {
+    expect(responses[i].asInt() == 4 * i + 6, "a fan-out is out of order");
+  }
+
+  expect(broker.callAll({}).empty(), "an empty fan-out returned responses");
+
+  /* More nested fan-outs than the executor has threads. */
+  std::vector<std::future<Json::Value>> futures;
+  for (int i = 0; i < 32; ++i) futures.push_back(broker.callAsync("fan", {}));
+  for (std::future<Json::Value>& future : futures) {
+    expect(future.get().asInt() == 28, "a nested fan-out returned wrong");
+  }
+
+  bool isThrown = false;
+  try {
+    broker.callAsync("fail", {}).get();
+  } catch (const std::runtime_error&) {
+    isThrown = true;
+  }
+
+  expect(isThrown, "an asynchronous call swallowed an error");
+  isThrown = false;
+  try {
+    broker.callAll({{"wait", {}}, {"fail", {}}, {"wait", {}}});
+  } catch (const std::runtime_error&) {
+    isThrown = true;
+  }
+
+  expect(isThrown, "a fan-out swallowed an error");
+
+  /* Calls from several threads at once resolve their own responses. */
+  std::atomic<int> errors(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&broker, &errors, t]() {
+      for (int i = 0; i < 500; ++i) {
+        const int seed = t * 1000 + i;
+        const Json::Value res = broker.call("first.welcome", getNumbers(seed));
+        if (res.asInt() != 4 * seed + 6) errors++;
+      }
+    });
+  }
+
+  for (std::thread& thread : threads) thread.join();
+  expect(!errors, "concurrent calls mixed up their responses");
+
+  /* Topics subscribed, and subscribed again, while calls are running. */
+  threads.clear();
+  threads.emplace_back([&broker]() {
+    for (int i = 0; i < 200; ++i) {
+      broker.subscribe("late." + std::to_string(i),
+                       [i](const Ctx& ctx) -> Json::Value { return i; });
+      broker.subscribe("late", [i](const Ctx& ctx) -> Json::Value {
+        return i;
+      });
+    }
+  });
+
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&broker, &errors, t]() {
+      for (int i = 0; i < 500; ++i) {
+        const int seed = t * 1000 + i;
+        const Json::Value res = broker.call("first.welcome", getNumbers(seed));
+        if (res.asInt() != 4 * seed + 6) errors++;
+      }
+    });
+  }
+
+  for (std::thread& thread : threads) thread.join();
+  expect(!errors, "calls failed while topics were subscribed");
+  expect(broker.call("late.199", {}).asInt() == 199,
+         "a topic subscribed during calls is missing");
+  expect(broker.call("late", {}).asInt() == 199,
+         "a topic subscribed again kept its first action");
+}
+
+/* Calls of the First -> Second chain per second: serialized with a
+   thread per call as before, serialized on the calling thread, and
+   dispatched locally. Then eight calls that each wait for 2 ms, one
+   after another and fanned out. */
+void benchBroker(const int& iterations) {
+  ArnelifyBroker serialized(false);
+  ArnelifyBroker broker;
+  subscribe(serialized);
+  subscribe(broker);
+  const Json::Value params = getNumbers(1);
+
+  for (const int mode : {0, 1, 2}) {
+    ArnelifyBroker& current = mode == 2 ? broker : serialized;
+    int checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      if (mode) {
+        checksum += current.call("first.welcome", params).asInt();
+        continue;
+      }
+
+      /* Both calls of the chain spawned and joined a thread. */
+      std::thread thread([&]() {
+        std::thread nested([&]() {
+          checksum += current.call("first.welcome", params).asInt();
+        });
+
+        nested.join();
+      });
+
+      thread.join();
+    }
+
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    const char* names[] = {"serialized, thread per call",
+                           "serialized, calling thread", "local"};
+    expect(checksum == 10 * iterations, "the chain returned a wrong sum");
+    std::cout << "broker, first -> second, " << names[mode] << ": "
+              << iterations / elapsed.count() << " calls/s" << std::endl;
+  }
+
+  std::vector<BrokerCall> calls;
+  for (int i = 0; i < 8; ++i) {
+    Json::Value params;
+    params["id"] = i;
+    params["ms"] = 2;
+    calls.push_back({"wait", params});
+  }
+
+  for (const bool isFanOut : {false, true}) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 20; ++i) {
+      if (isFanOut) {
+        broker.callAll(calls);
+        continue;
+      }
+
+      for (const BrokerCall& call : calls) broker.call(call.topic, call.params);
+    }
+
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << "broker, 8 calls of 2 ms, "
+              << (isFanOut ? "callAll" : "one after another") << ": "
+              << elapsed.count() / 20 * 1e3 << " ms" << std::endl;
+  }
+}
+
+int main(int argc, char* argv[]) {
+  const int iterations = argc > 1 ? std::stoi(argv[1]) : 20000;
+  checkBroker(true);
+  checkBroker(false);
+  benchBroker(iterations);
+  return 0;
+}
+
+#endif
\ No newline at end of file
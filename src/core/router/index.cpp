@@ -7,4 +7,8 @@
 #include "src/cpp/index.cpp"
 #endif
 
+#include "src/cpp/cache/index.cpp"
+
+ArnelifyRouteCache* routeCache = new ArnelifyRouteCache(64 * 1048576);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,231 @@
+#ifndef ARNELIFY_ROUTE_CACHE_CPP
+#define ARNELIFY_ROUTE_CACHE_CPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "json.h"
+
+#include "../contracts/cache.hpp"
+
+/* Responses of the routes that opted in, shared by every worker. Keys are
+   spread over shards that each have their own lock, LRU list and byte
+   budget, so concurrent lookups of different keys rarely wait on each
+   other. Expired entries are dropped when they are looked up. Every tag
+   has a generation that invalidate() moves on, so a response computed
+   while one of its tags was invalidated isn't stored. */
+class ArnelifyRouteCache final {
+ public:
+  struct Response {
+    int code;
+    std::string body;
+  };
+
+  using Bytes = std::shared_ptr<const Response>;
+  using Clock = std::chrono::steady_clock;
+  using Generations = std::vector<std::uint64_t>;
+
+ private:
+  static constexpr std::size_t SHARDS = 16;
+
+  struct Entry {
+    std::string key;
+    Clock::time_point expires;
+    std::vector<std::string> tags;
+    Bytes response;
+  };
+
+  struct Shard {
+    std::size_t bytes = 0;
+    std::list<Entry> entries;
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    std::unordered_map<std::string, std::unordered_set<std::string>> tagged;
+    std::mutex mutex;
+  };
+
+  std::atomic<std::size_t> capacity;
+  std::array<Shard, SHARDS> shards;
+  std::mutex tagsMtx;
+  std::unordered_map<std::string, std::uint64_t> generations;
+
+  static std::size_t getSize(const Entry &entry) {
+    return entry.key.length() + entry.response->body.length();
+  }
+
+  Shard &getShard(const std::string &key) {
+    return this->shards[std::hash<std::string>{}(key) % SHARDS];
+  }
+
+  static void erase(Shard &shard, const std::list<Entry>::iterator &it) {
+    for (const std::string &tag : it->tags) {
+      auto tagIt = shard.tagged.find(tag);
+      if (tagIt == shard.tagged.end()) continue;
+
+      tagIt->second.erase(it->key);
+      if (tagIt->second.empty()) shard.tagged.erase(tagIt);
+    }
+
+    shard.bytes -= getSize(*it);
+    shard.index.erase(it->key);
+    shard.entries.erase(it);
+  }
+
+  Generations getGenerations(const std::vector<std::string> &tags) {
+    Generations generations;
+    generations.reserve(tags.size());
+    std::lock_guard<std::mutex> lock(this->tagsMtx);
+    for (const std::string &tag : tags) {
+      auto it = this->generations.find(tag);
+      const bool hasTag = it != this->generations.end();
+      generations.push_back(hasTag ? it->second : 0);
+    }
+
+    return generations;
+  }
+
+  /* One response may take up to a quarter of a shard, so a single large
+     response can't flush everything else. The generations are compared
+     under the shard's lock, which invalidate() takes after moving them
+     on, so either the response isn't stored or invalidate() drops it. */
+  void set(const std::string &key, const RouteCache &policy,
+           const Bytes &response, const Generations &generations) {
+    const std::chrono::seconds ttl(policy.ttl);
+    const Clock::time_point expires =
+        policy.ttl > 0 ? Clock::now() + ttl : Clock::time_point::max();
+    Entry entry{key, expires, policy.tags, response};
+    const std::size_t size = getSize(entry);
+    const std::size_t capacity = this->capacity / SHARDS;
+
+    Shard &shard = this->getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    const bool isCurrent = this->getGenerations(policy.tags) == generations;
+    if (!isCurrent) return;
+
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) erase(shard, it->second);
+    if (size > capacity / 4) return;
+
+    while (shard.bytes + size > capacity) {
+      erase(shard, std::prev(shard.entries.end()));
+    }
+
+    shard.entries.push_front(std::move(entry));
+    shard.index[key] = shard.entries.begin();
+    for (const std::string &tag : policy.tags) shard.tagged[tag].insert(key);
+    shard.bytes += size;
+  }
+
+  /* Appends "value" with its length in front, so values that contain
+     the separator can't run into each other. */
+  static void addKey(std::string &key, const std::string_view &value) {
+    key += std::to_string(value.length());
+    key += ':';
+    key += value;
+  }
+
+ public:
+  /* "capacity" is split evenly between the shards. */
+  ArnelifyRouteCache(const std::size_t &c) : capacity(c) {}
+
+  /* Status of a controller's response: its integer "code", or 200. */
+  static int getCode(const Json::Value &response) {
+    const bool hasCode = response.isObject() && response["code"].isInt();
+    return hasCode ? response["code"].asInt() : 200;
+  }
+
+  /* Key of a request to a route cached with "policy". A request is
+     anything with the getters of ArnelifyServerReq. */
+  template <typename Request>
+  static void setKey(std::string &key, const RouteCache &policy,
+                     const Request &req) {
+    key.clear();
+    addKey(key, req.getMethod());
+    addKey(key, req.getPath());
+    for (const std::string &name : policy.query) {
+      addKey(key, req.getQuery(name));
+    }
+
+    for (const std::string &name : policy.headers) {
+      addKey(key, req.getHeader(name));
+    }
+  }
+
+  void clear() {
+    for (Shard &shard : this->shards) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      shard.bytes = 0;
+      shard.entries.clear();
+      shard.index.clear();
+      shard.tagged.clear();
+    }
+  }
+
+  Bytes get(const std::string &key) {
+    Shard &shard = this->getShard(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) return nullptr;
+
+    const bool isExpired = it->second->expires <= Clock::now();
+    if (isExpired) {
+      erase(shard, it->second);
+      return nullptr;
+    }
+
+    shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+    return it->second->response;
+  }
+
+  /* Drops every response cached with "tag", as a service does after a
+     write the responses depend on. */
+  void invalidate(const std::string &tag) {
+    {
+      std::lock_guard<std::mutex> lock(this->tagsMtx);
+      this->generations[tag] += 1;
+    }
+
+    for (Shard &shard : this->shards) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto tagIt = shard.tagged.find(tag);
+      if (tagIt == shard.tagged.end()) continue;
+
+      const std::unordered_set<std::string> keys = tagIt->second;
+      for (const std::string &key : keys) {
+        erase(shard, shard.index.find(key)->second);
+      }
+    }
+  }
+
+  /* Sets the byte budget, 0 turning caching off. A smaller budget is
+     reached as responses are stored. */
+  void setCapacity(const std::size_t &capacity) { this->capacity = capacity; }
+
+  /* The response cached under "key", or the one "render" returns, which
+     is stored when its code is 200. The generations of the policy's tags
+     are read before "render" runs. */
+  template <typename Render>
+  Bytes fetch(const std::string &key, const RouteCache &policy,
+              const Render &render) {
+    Bytes response = this->get(key);
+    if (response) return response;
+
+    const Generations generations = this->getGenerations(policy.tags);
+    response = std::make_shared<const Response>(render());
+    const bool isStored = response->code == 200;
+    if (isStored) this->set(key, policy, response, generations);
+    return response;
+  }
+};
+
+#endif
\ No newline at end of file
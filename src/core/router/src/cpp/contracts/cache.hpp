@@ -0,0 +1,18 @@
+#ifndef ARNELIFY_ROUTER_CACHE_HPP
+#define ARNELIFY_ROUTER_CACHE_HPP
+
+#include <iostream>
+#include <vector>
+
+/* Opt-in caching of the responses of a GET route. A response is kept for
+   "ttl" seconds, or until it is evicted when "ttl" is 0, under the path
+   of its request and the values of the listed query params and headers.
+   Services drop the responses of every route with a tag at once. */
+struct RouteCache {
+  int ttl;
+  std::vector<std::string> query;
+  std::vector<std::string> headers;
+  std::vector<std::string> tags;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,24 @@
+#ifndef ARNELIFY_ROUTER_MATCH_HPP
+#define ARNELIFY_ROUTER_MATCH_HPP
+
+/* Route found by router_match, filled in place of the caller so a lookup
+   crosses the library boundary without JSON or heap memory. "method" is
+   0 for an "any" route, then GET, POST, PUT, PATCH and DELETE. Params are
+   offsets into the path that was looked up, in pattern order; a route
+   with more than ROUTER_MATCH_PARAMS of them reports its full count and
+   fills the first ones only. */
+constexpr int ROUTER_MATCH_PARAMS = 16;
+
+struct RouterParam {
+  int start;
+  int length;
+};
+
+struct RouterMatch {
+  int id;
+  int method;
+  int paramsLen;
+  RouterParam params[ROUTER_MATCH_PARAMS];
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,31 @@
+#ifndef ARNELIFY_ROUTER_NODE_HPP
+#define ARNELIFY_ROUTER_NODE_HPP
+
+#include <array>
+#include <functional>
+#include <iostream>
+#include <string_view>
+#include <unordered_map>
+
+/* Segment of the route tree. Static children are looked up by the path
+   segment itself, without copying it; the single param child takes any
+   segment. "routes" holds the index of the route ending here for each
+   method, "any" routes first, or -1. */
+struct RouterNode {
+  struct Hash {
+    using is_transparent = void;
+    std::size_t operator()(const std::string_view &segment) const {
+      return std::hash<std::string_view>{}(segment);
+    }
+  };
+
+  static constexpr std::size_t npos = -1;
+
+  std::size_t param;
+  std::array<int, 6> routes;
+  std::unordered_map<std::string, std::size_t, Hash, std::equal_to<>> statics;
+
+  RouterNode() : param(npos) { routes.fill(-1); }
+};
+
+#endif
\ No newline at end of file
@@ -5,14 +5,17 @@
 
 struct Route {
   int id;
+  /* The JSON or urlencoded body reaches the controller as the string it
+     was received as and is never parsed. */
+  bool isRaw;
   std::optional<std::string> method;
   Json::Value params;
   std::string pattern;
 
   /* It's important that the arguments aren't references */
   Route(const int i, const std::optional<std::string> m, const Json::Value par,
-        const std::string pat)
-      : id(i), method(m), params(par), pattern(pat) {}
+        const std::string pat, const bool raw = false)
+      : id(i), isRaw(raw), method(m), params(par), pattern(pat) {}
 };
 
 using RouterCallback = std::function<void(const std::optional<Route>&)>;
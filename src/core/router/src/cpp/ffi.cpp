@@ -1,6 +1,7 @@
 #ifndef ARNELIFY_ROUTER_FFI_CPP
 #define ARNELIFY_ROUTER_FFI_CPP
 
+#include "contracts/match.hpp"
 #include "index.cpp"
 
 extern "C" {
@@ -76,6 +77,34 @@ const char* router_find(char* cMethod, char* cPath) {
   return cRouteOpt;
 }
 
+/* Fills "cMatch" with the route "cPath" leads to for "cMethod" and
+   returns its id, or -1 when there is none. */
+int router_match(const char* cMethod, const char* cPath,
+                 RouterMatch* cMatch) {
+  thread_local std::vector<std::string_view> values;
+  values.clear();
+
+  const int index = router->match(cMethod, cPath, values);
+  cMatch->paramsLen = 0;
+  if (index < 0) {
+    cMatch->id = -1;
+    return -1;
+  }
+
+  const Route& route = router->getRoute(index);
+  cMatch->id = route.id;
+  cMatch->method = route.method ? ArnelifyRouter::getMethod(*route.method) : 0;
+  cMatch->paramsLen = values.size();
+  const std::size_t paramsLen =
+      std::min<std::size_t>(values.size(), ROUTER_MATCH_PARAMS);
+  for (std::size_t i = 0; i < paramsLen; ++i) {
+    cMatch->params[i].start = values[i].data() - cPath;
+    cMatch->params[i].length = values[i].length();
+  }
+
+  return route.id;
+}
+
 void router_free(const char* cPointer) {
   if (cPointer) delete[] cPointer;
 }
@@ -1,20 +1,37 @@
 #ifndef ARNELIFY_ROUTER_CPP
 #define ARNELIFY_ROUTER_CPP
 
-#include <algorithm>
+#include <atomic>
 #include <functional>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <optional>
+#include <string_view>
 #include <vector>
 
+#include "contracts/cache.hpp"
 #include "contracts/controller.hpp"
+#include "contracts/node.hpp"
 #include "contracts/route.hpp"
 #include "contracts/segments.hpp"
 
+/* Routes are kept as a tree of path segments, so a lookup walks the path
+   once instead of comparing it with every pattern. Static segments are
+   tried before a param at every level, and a route registered for the
+   method of the request before an "any" route. Registering a route only
+   splits its pattern; the tree is built once, when the table is frozen,
+   and stays read-only from then on. */
 class ArnelifyRouter {
  private:
   int iterator;
+  std::atomic<bool> isFrozen;
+  std::mutex mtx;
+  std::map<int, RouteCache> caches;
   std::map<int, Controller> controllers;
+  std::vector<Segments> keys;
+  std::vector<RouterNode> nodes;
+  std::vector<Segments> patterns;
   std::vector<Route> routes;
 
   const Segments split(const std::string& string,
@@ -32,134 +49,176 @@ class ArnelifyRouter {
     return segments;
   }
 
-  const int paramsLen(const Segments& segments) {
-    auto condition = [segments](const std::string& segment) {
-      return !segment.empty() && segment[0] == ':';
-    };
-
-    return std::count_if(segments.begin(), segments.end(), condition);
-  };
-
-  void sort() {
-    std::sort(this->routes.begin(), this->routes.end(),
-              [this](const Route& a, const Route& b) {
-                const auto segmentsA = this->split(a.pattern, "/");
-                const auto segmentsB = this->split(b.pattern, "/");
-                const int paramsA = this->paramsLen(segmentsA);
-                const int paramsB = this->paramsLen(segmentsB);
-                const bool isParamsEqual = paramsA == paramsB;
-                if (!isParamsEqual) return paramsA < paramsB;
-                return segmentsA.size() < segmentsB.size();
-              });
-  }
-
-  const std::optional<Route> compare(Route& route,
-                                     const Segments& routeSegments,
-                                     const Segments& pathSegments) {
-    const bool isLenEqual = routeSegments.size() == pathSegments.size();
-    if (!isLenEqual) return std::nullopt;
-
-    for (std::size_t i = 0; routeSegments.size() > i; ++i) {
-      bool hasParam = routeSegments[i].starts_with(':');
-      if (hasParam) {
-        const std::string key = routeSegments[i].substr(1);
-        const std::string param = pathSegments[i];
-        route.params[key] = param;
+  /* Lookups read the tree without a lock once it is frozen, so a route
+     registered after that would race them and is refused. */
+  void add(const std::string& pattern, const Controller& controller,
+           const std::optional<std::string>& method, const bool& isRaw,
+           const std::optional<RouteCache>& cache = std::nullopt) {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (this->isFrozen) {
+      std::cout << "[Arnelify Router]: Error: Route '" << pattern
+                << "' was added after the first lookup." << std::endl;
+      exit(1);
+    }
+
+    const int id = this->iterator;
+    if (cache) this->caches[id] = *cache;
+    this->controllers[id] = controller;
+    this->iterator++;
+
+    this->patterns.emplace_back(this->split(pattern, "/"));
+    this->routes.emplace_back(id, method, Json::objectValue, pattern, isRaw);
+  }
+
+  void build() {
+    std::size_t nodesTotal = 1;
+    for (const Segments& segments : this->patterns) {
+      nodesTotal += segments.size();
+    }
+
+    this->keys.clear();
+    this->keys.resize(this->routes.size());
+    this->nodes.clear();
+    this->nodes.reserve(nodesTotal);
+    this->nodes.emplace_back();
+    for (std::size_t i = 0; i < this->routes.size(); ++i) this->insert(i);
+  }
+
+  void insert(const std::size_t& index) {
+    Segments& keys = this->keys[index];
+    std::size_t node = 0;
+    for (const std::string& segment : this->patterns[index]) {
+      const bool isParam = segment.starts_with(':');
+      if (isParam) {
+        keys.emplace_back(segment.substr(1));
+        const bool hasParam = this->nodes[node].param != RouterNode::npos;
+        if (!hasParam) {
+          this->nodes[node].param = this->nodes.size();
+          this->nodes.emplace_back();
+        }
+
+        node = this->nodes[node].param;
+        continue;
+      }
+
+      const auto it = this->nodes[node].statics.find(segment);
+      const bool hasStatic = it != this->nodes[node].statics.end();
+      if (hasStatic) {
+        node = it->second;
         continue;
       }
 
-      const bool isMatch = routeSegments[i] == pathSegments[i];
-      if (!isMatch) return std::nullopt;
+      const std::size_t child = this->nodes.size();
+      this->nodes[node].statics.emplace(segment, child);
+      this->nodes.emplace_back();
+      node = child;
     }
 
-    return route;
+    /* The route registered first keeps its pattern and method. */
+    const std::optional<std::string>& method = this->routes[index].method;
+    int& slot = this->nodes[node].routes[method ? getMethod(*method) : 0];
+    if (slot < 0) slot = index;
   }
 
- public:
-  ArnelifyRouter() : iterator(0) {}
-  void any(const std::string& pattern, const Controller& controller) {
-    const int id = this->iterator;
-    this->controllers[id] = controller;
-    this->iterator++;
+  int search(const std::size_t& node, const std::string_view& path,
+             const std::size_t& start, const int& method,
+             std::vector<std::string_view>& values) const {
+    const RouterNode& current = this->nodes[node];
+    const bool isEnd = start == std::string_view::npos;
+    if (isEnd) {
+      const bool hasMethod = method && current.routes[method] >= 0;
+      return hasMethod ? current.routes[method] : current.routes[0];
+    }
 
-    Json::Value params = Json::objectValue;
-    Route route(id, std::nullopt, params, pattern);
-    this->routes.emplace_back(route);
-    this->sort();
-  }
+    const std::size_t end = path.find('/', start);
+    const std::string_view segment = path.substr(start, end - start);
+    const std::size_t next = end == std::string_view::npos ? end : end + 1;
 
-  void get(const std::string& pattern, const Controller& controller) {
-    const int id = this->iterator;
-    this->controllers[id] = controller;
-    this->iterator++;
+    const auto it = current.statics.find(segment);
+    const bool hasStatic = it != current.statics.end();
+    if (hasStatic) {
+      const int index = this->search(it->second, path, next, method, values);
+      if (index >= 0) return index;
+    }
+
+    const bool hasParam = current.param != RouterNode::npos;
+    if (!hasParam) return -1;
 
-    Json::Value params = Json::objectValue;
-    Route route(id, "GET", params, pattern);
-    this->routes.emplace_back(route);
-    this->sort();
+    values.push_back(segment);
+    const int index = this->search(current.param, path, next, method, values);
+    if (index < 0) values.pop_back();
+    return index;
   }
 
-  void post(const std::string& pattern, const Controller& controller) {
-    const int id = this->iterator;
-    this->controllers[id] = controller;
-    this->iterator++;
+ public:
+  ArnelifyRouter() : iterator(0), isFrozen(false) {}
 
-    Json::Value params = Json::objectValue;
-    Route route(id, "POST", params, pattern);
-    this->routes.emplace_back(route);
-    this->sort();
+  /* Slot of a method in RouterNode::routes. Methods without a verb of
+     their own only reach "any" routes. */
+  static int getMethod(const std::string_view& method) {
+    if (method == "GET") return 1;
+    if (method == "POST") return 2;
+    if (method == "PUT") return 3;
+    if (method == "PATCH") return 4;
+    if (method == "DELETE") return 5;
+    return 0;
   }
 
-  void put(const std::string& pattern, const Controller& controller) {
-    const int id = this->iterator;
-    this->controllers[id] = controller;
-    this->iterator++;
+  void any(const std::string& pattern, const Controller& controller,
+           const bool& isRaw = false) {
+    this->add(pattern, controller, std::nullopt, isRaw);
+  }
 
-    Json::Value params = Json::objectValue;
-    Route route(id, "PUT", params, pattern);
-    this->routes.emplace_back(route);
-    this->sort();
+  /* With "cache" the responses of the route are cached by the server. */
+  void get(const std::string& pattern, const Controller& controller,
+           const bool& isRaw = false,
+           const std::optional<RouteCache>& cache = std::nullopt) {
+    this->add(pattern, controller, "GET", isRaw, cache);
   }
 
-  void patch(const std::string& pattern, const Controller& controller) {
-    const int id = this->iterator;
-    this->controllers[id] = controller;
-    this->iterator++;
+  void post(const std::string& pattern, const Controller& controller,
+            const bool& isRaw = false) {
+    this->add(pattern, controller, "POST", isRaw);
+  }
 
-    Json::Value params = Json::objectValue;
-    Route route(id, "PATCH", params, pattern);
-    this->routes.emplace_back(route);
-    this->sort();
+  void put(const std::string& pattern, const Controller& controller,
+           const bool& isRaw = false) {
+    this->add(pattern, controller, "PUT", isRaw);
   }
 
-  void delete_(const std::string& pattern, const Controller& controller) {
-    const int id = this->iterator;
-    this->controllers[id] = controller;
-    this->iterator++;
+  void patch(const std::string& pattern, const Controller& controller,
+             const bool& isRaw = false) {
+    this->add(pattern, controller, "PATCH", isRaw);
+  }
 
-    Json::Value params = Json::objectValue;
-    Route route(id, "DELETE", params, pattern);
-    this->routes.emplace_back(route);
-    this->sort();
+  void delete_(const std::string& pattern, const Controller& controller,
+               const bool& isRaw = false) {
+    this->add(pattern, controller, "DELETE", isRaw);
   }
 
   const std::optional<Route> find(const std::string& method,
                                   const std::string& path) {
-    const Segments pathSegments = this->split(path, "/");
-    for (Route route : routes) {
-      std::optional<Route> routeOpt;
-      if (route.method && *route.method == method) {
-        const Segments routeSegments = this->split(route.pattern, "/");
-        routeOpt = this->compare(route, routeSegments, pathSegments);
-        if (routeOpt) return routeOpt;
-      } else {
-        const Segments routeSegments = this->split(route.pattern, "/");
-        routeOpt = this->compare(route, routeSegments, pathSegments);
-        if (routeOpt) return routeOpt;
-      }
+    std::vector<std::string_view> values;
+    const int index = this->match(method, path, values);
+    if (index < 0) return std::nullopt;
+
+    Route route = this->routes[index];
+    const Segments& keys = this->keys[index];
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      const std::string_view value = values[i];
+      route.params[keys[i]] = Json::Value(value.data(),
+                                          value.data() + value.length());
     }
 
-    return std::nullopt;
+    return route;
+  }
+
+  /* Cache policy of a route, or nullptr when its responses aren't
+     cached. */
+  const RouteCache* getCache(const int& id) const {
+    auto it = this->caches.find(id);
+    const bool hasId = it != this->caches.end();
+    return hasId ? &it->second : nullptr;
   }
 
   const std::optional<Controller> getController(const int& id) {
@@ -169,9 +228,38 @@ class ArnelifyRouter {
     return std::nullopt;
   }
 
+  /* Builds the route tree from the routes registered so far. The first
+     lookup does it too. Routes can't be added after that, until reset(). */
+  void freeze() {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (this->isFrozen) return;
+    this->build();
+    this->isFrozen = true;
+  }
+
+  /* Route of an index match() returned. */
+  const Route& getRoute(const int& index) const { return this->routes[index]; }
+
+  /* Index of the route "path" leads to for "method", or -1. Its params
+     are appended to "values" as views of the path, in pattern order, so
+     nothing is allocated unless the route has params. */
+  int match(const std::string_view& method, const std::string_view& path,
+            std::vector<std::string_view>& values) {
+    if (!this->isFrozen) this->freeze();
+    return this->search(0, path, 0, getMethod(method), values);
+  }
+
+  /* Drops every route, so a table can be registered anew. Lookups must
+     not run meanwhile. */
   void reset() {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->caches.clear();
     this->controllers.clear();
+    this->keys.clear();
+    this->nodes.clear();
+    this->patterns.clear();
     this->routes.clear();
+    this->isFrozen = false;
   }
 };
 
@@ -0,0 +1,206 @@
+#ifndef ARNELIFY_ROUTER_TABLE_CPP
+#define ARNELIFY_ROUTER_TABLE_CPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "json.h"
+
+#include "../contracts/cache.hpp"
+#include "../contracts/controller.hpp"
+
+using StaticController = Json::Value (*)(const Ctx &);
+
+/* Route known at build time. An empty method is an "any" route. The
+   cache policy of a GET route is a pointer, as its lists can't be part of
+   a constant. */
+struct StaticRoute {
+  std::string_view method;
+  std::string_view pattern;
+  StaticController controller;
+  bool isRaw = false;
+  const RouteCache *cache = nullptr;
+};
+
+/* Route table compiled with the build. Patterns without params are laid
+   out in a perfect hash table while the table is constant-evaluated, so
+   a lookup hashes the path twice and compares one pattern. Patterns with
+   params are only served by the dynamic router. install() registers every
+   route of the table into it before the first lookup freezes it, so
+   lookups that miss here still find them there. */
+template <std::size_t N>
+class ArnelifyRouteTable final {
+ private:
+  static constexpr std::size_t SIZE = std::bit_ceil(N * 2);
+
+  std::array<StaticRoute, N> routes;
+  std::array<std::uint32_t, SIZE> seeds;
+  std::array<int, SIZE> slots;
+
+  static constexpr int getMethod(const std::string_view &method) {
+    if (method.empty()) return 0;
+    if (method == "GET") return 1;
+    if (method == "POST") return 2;
+    if (method == "PUT") return 3;
+    if (method == "PATCH") return 4;
+    if (method == "DELETE") return 5;
+    return -1;
+  }
+
+  static constexpr bool isStatic(const std::string_view &pattern) {
+    return pattern.find(':') == std::string_view::npos;
+  }
+
+  /* FNV-1a of the method slot and the path, starting from "seed". */
+  static constexpr std::size_t hash(const std::uint32_t &seed,
+                                    const int &method,
+                                    const std::string_view &path) {
+    std::uint64_t value = 14695981039346656037ull ^ seed;
+    value = (value ^ static_cast<std::uint64_t>(method)) * 1099511628211ull;
+    for (const char c : path) {
+      value = (value ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+
+    return (value ^ value >> 29) & (SIZE - 1);
+  }
+
+  /* Hash and displace: routes are grouped in buckets by their unseeded
+     hash, and from the largest bucket down each bucket gets the first
+     seed that places all its routes in free slots. */
+  constexpr void build() {
+    std::array<std::size_t, N> buckets{};
+    std::array<std::size_t, SIZE> sizes{};
+    std::size_t maxSize = 0;
+    for (std::size_t i = 0; i < N; ++i) {
+      const StaticRoute &route = this->routes[i];
+      const int method = getMethod(route.method);
+      if (method < 0) throw std::logic_error("Unsupported route method.");
+      if (!isStatic(route.pattern)) continue;
+
+      for (std::size_t j = 0; j < i; ++j) {
+        const bool isDuplicate = this->routes[j].pattern == route.pattern &&
+                                 this->routes[j].method == route.method;
+        if (isDuplicate) throw std::logic_error("Duplicate route.");
+      }
+
+      buckets[i] = hash(0, method, route.pattern);
+      maxSize = std::max(maxSize, ++sizes[buckets[i]]);
+    }
+
+    for (std::size_t size = maxSize; size > 0; --size) {
+      for (std::size_t bucket = 0; bucket < SIZE; ++bucket) {
+        if (sizes[bucket] != size) continue;
+        this->seeds[bucket] = this->place(buckets, bucket);
+      }
+    }
+  }
+
+  constexpr std::uint32_t place(const std::array<std::size_t, N> &buckets,
+                                const std::size_t &bucket) {
+    for (std::uint32_t seed = 1; seed < 1u << 20; ++seed) {
+      std::array<std::size_t, N> taken{};
+      std::size_t takenLen = 0;
+      bool isPlaced = true;
+      for (std::size_t i = 0; isPlaced && i < N; ++i) {
+        const StaticRoute &route = this->routes[i];
+        if (!isStatic(route.pattern) || buckets[i] != bucket) continue;
+
+        const std::size_t slot =
+            hash(seed, getMethod(route.method), route.pattern);
+        isPlaced = this->slots[slot] < 0;
+        for (std::size_t j = 0; isPlaced && j < takenLen; ++j) {
+          isPlaced = taken[j] != slot;
+        }
+
+        taken[takenLen++] = slot;
+      }
+
+      if (!isPlaced) continue;
+
+      std::size_t next = 0;
+      for (std::size_t i = 0; i < N; ++i) {
+        const StaticRoute &route = this->routes[i];
+        if (!isStatic(route.pattern) || buckets[i] != bucket) continue;
+        this->slots[taken[next++]] = static_cast<int>(i);
+      }
+
+      return seed;
+    }
+
+    throw std::logic_error("No perfect hash for the route table.");
+  }
+
+  constexpr const StaticRoute *get(const int &method,
+                                   const std::string_view &path) const {
+    const std::uint32_t seed = this->seeds[hash(0, method, path)];
+    const int index = this->slots[hash(seed, method, path)];
+    if (index < 0) return nullptr;
+
+    const StaticRoute &route = this->routes[index];
+    const bool isMatch =
+        getMethod(route.method) == method && route.pattern == path;
+    return isMatch ? &route : nullptr;
+  }
+
+ public:
+  constexpr ArnelifyRouteTable(const StaticRoute (&routes)[N])
+      : routes{}, seeds{}, slots{} {
+    for (std::size_t i = 0; i < N; ++i) this->routes[i] = routes[i];
+    this->slots.fill(-1);
+    this->build();
+  }
+
+  /* The static route "path" leads to for "method", a route of the method
+     before an "any" route, or nullptr. */
+  constexpr const StaticRoute *find(const std::string_view &method,
+                                    const std::string_view &path) const {
+    const int slot = getMethod(method);
+    if (slot > 0) {
+      const StaticRoute *route = this->get(slot, path);
+      if (route) return route;
+    }
+
+    return this->get(0, path);
+  }
+
+  /* Registers every route of the table into a dynamic router, which has
+     to happen before its first lookup. */
+  template <typename Router>
+  void install(Router &router) const {
+    for (const StaticRoute &route : this->routes) {
+      const std::string pattern(route.pattern);
+      switch (getMethod(route.method)) {
+        case 1:
+          if (!route.cache) {
+            router.get(pattern, route.controller, route.isRaw);
+            break;
+          }
+
+          router.get(pattern, route.controller, route.isRaw, *route.cache);
+          break;
+        case 2:
+          router.post(pattern, route.controller, route.isRaw);
+          break;
+        case 3:
+          router.put(pattern, route.controller, route.isRaw);
+          break;
+        case 4:
+          router.patch(pattern, route.controller, route.isRaw);
+          break;
+        case 5:
+          router.delete_(pattern, route.controller, route.isRaw);
+          break;
+        default:
+          router.any(pattern, route.controller, route.isRaw);
+      }
+    }
+  }
+};
+
+#endif
\ No newline at end of file
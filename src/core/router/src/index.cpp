@@ -5,19 +5,30 @@
 #include <filesystem>
 #include <iostream>
 #include <optional>
+#include <set>
 #include <stdexcept>
 
 #include "json.h"
 
+#include "cpp/contracts/cache.hpp"
 #include "cpp/contracts/controller.hpp"
+#include "cpp/contracts/match.hpp"
 #include "cpp/contracts/route.hpp"
+#include "cpp/contracts/segments.hpp"
 
 class ArnelifyRouter {
  private:
   void* lib = nullptr;
   std::filesystem::path libPath;
+  std::map<int, RouteCache> caches;
   std::map<int, Controller> controllers;
   int iterator;
+  /* Param names and patterns of the routes, so a match from the library
+     is turned into a Route without asking it for them. */
+  std::map<int, Segments> keys;
+  std::map<int, std::string> patterns;
+  /* Routes registered as raw-body, as the library only keeps patterns. */
+  std::set<int> raws;
 
   void (*router_create)();
   void (*router_destroy)();
@@ -29,6 +40,7 @@ class ArnelifyRouter {
   void (*router_delete)(const char*);
   const char* (*router_find)(const char*, const char*);
   void (*router_free)(const char*);
+  int (*router_match)(const char*, const char*, RouterMatch*);
   void (*router_reset)();
 
   template <typename T>
@@ -77,6 +89,58 @@ class ArnelifyRouter {
     return libPath;
   }
 
+  void setPattern(const int& id, const std::string& pattern) {
+    Segments& keys = this->keys[id];
+    std::size_t segmentStart = 0;
+    while (segmentStart <= pattern.length()) {
+      std::size_t segmentEnd = pattern.find('/', segmentStart);
+      if (segmentEnd == std::string::npos) segmentEnd = pattern.length();
+
+      const bool isParam = pattern[segmentStart] == ':';
+      if (isParam) {
+        keys.emplace_back(pattern.substr(segmentStart + 1,
+                                         segmentEnd - segmentStart - 1));
+      }
+
+      segmentStart = segmentEnd + 1;
+    }
+
+    this->patterns[id] = pattern;
+  }
+
+  /* The route as the library serialises it, for a match with more params
+     than RouterMatch holds. */
+  std::optional<Route> findSerialized(const std::string& method,
+                                      const std::string& path) {
+    const char* cRouteOpt = this->router_find(method.c_str(), path.c_str());
+
+    Json::Value routeOpt;
+    Json::CharReaderBuilder reader;
+    std::string errors;
+
+    std::istringstream iss(cRouteOpt);
+    if (!Json::parseFromStream(reader, iss, &routeOpt, &errors)) {
+      std::cout << "[ArnelifyRouter FFI]: C error: Invalid cRouteOpt."
+                << std::endl;
+      exit(1);
+    }
+
+    this->router_free(cRouteOpt);
+
+    if (!routeOpt.isMember("id")) return std::nullopt;
+
+    std::optional<std::string> methodOpt;
+    if (routeOpt.isMember("method") && !routeOpt["method"].isNull()) {
+      methodOpt = routeOpt["method"].asString();
+    }
+
+    const int id = routeOpt["id"].asInt();
+    const bool isRaw = this->raws.contains(id);
+    Route route(id, methodOpt, routeOpt["params"],
+                routeOpt["pattern"].asString(), isRaw);
+    return route;
+  }
+
  public:
   ArnelifyRouter() : iterator(0) {
     const std::string libPath = this->getLibPath();
@@ -93,6 +157,7 @@ class ArnelifyRouter {
     loadFunction("router_delete", this->router_delete);
     loadFunction("router_find", this->router_find);
     loadFunction("router_free", this->router_free);
+    loadFunction("router_match", this->router_match);
     loadFunction("router_reset", this->router_reset);
 
     this->router_create();
@@ -105,83 +170,115 @@ class ArnelifyRouter {
     this->lib = nullptr;
   }
 
-  void any(const std::string& pattern, const Controller& controller) {
+  void any(const std::string& pattern, const Controller& controller,
+           const bool& isRaw = false) {
     const int id = this->iterator;
     this->controllers[id] = controller;
+    this->setPattern(id, pattern);
+    if (isRaw) this->raws.insert(id);
     this->iterator++;
 
     this->router_any(pattern.c_str());
   }
 
-  void get(const std::string& pattern, const Controller& controller) {
+  /* With "cache" the responses of the route are cached by the server. */
+  void get(const std::string& pattern, const Controller& controller,
+           const bool& isRaw = false,
+           const std::optional<RouteCache>& cache = std::nullopt) {
     const int id = this->iterator;
     this->controllers[id] = controller;
+    this->setPattern(id, pattern);
+    if (isRaw) this->raws.insert(id);
+    if (cache) this->caches[id] = *cache;
     this->iterator++;
 
     this->router_get(pattern.c_str());
   }
 
-  void post(const std::string& pattern, const Controller& controller) {
+  void post(const std::string& pattern, const Controller& controller,
+            const bool& isRaw = false) {
     const int id = this->iterator;
     this->controllers[id] = controller;
+    this->setPattern(id, pattern);
+    if (isRaw) this->raws.insert(id);
     this->iterator++;
 
-    this->router_get(pattern.c_str());
+    this->router_post(pattern.c_str());
   }
 
-  void put(const std::string& pattern, const Controller& controller) {
+  void put(const std::string& pattern, const Controller& controller,
+           const bool& isRaw = false) {
     const int id = this->iterator;
     this->controllers[id] = controller;
+    this->setPattern(id, pattern);
+    if (isRaw) this->raws.insert(id);
     this->iterator++;
 
-    this->router_get(pattern.c_str());
+    this->router_put(pattern.c_str());
   }
 
-  void patch(const std::string& pattern, const Controller& controller) {
+  void patch(const std::string& pattern, const Controller& controller,
+             const bool& isRaw = false) {
     const int id = this->iterator;
     this->controllers[id] = controller;
+    this->setPattern(id, pattern);
+    if (isRaw) this->raws.insert(id);
     this->iterator++;
 
-    this->router_get(pattern.c_str());
+    this->router_patch(pattern.c_str());
   }
 
-  void delete_(const std::string& pattern, const Controller& controller) {
+  void delete_(const std::string& pattern, const Controller& controller,
+               const bool& isRaw = false) {
     const int id = this->iterator;
     this->controllers[id] = controller;
+    this->setPattern(id, pattern);
+    if (isRaw) this->raws.insert(id);
     this->iterator++;
 
-    this->router_get(pattern.c_str());
+    this->router_delete(pattern.c_str());
   }
 
   std::optional<Route> find(const std::string& method,
                             const std::string& path) {
-    const char* cRouteOpt = this->router_find(method.c_str(), path.c_str());
-
-    Json::Value routeOpt;
-    Json::CharReaderBuilder reader;
-    std::string errors;
-
-    std::istringstream iss(cRouteOpt);
-    if (!Json::parseFromStream(reader, iss, &routeOpt, &errors)) {
-      std::cout << "[ArnelifyRouter FFI]: C error: Invalid cRouteOpt."
-                << std::endl;
-      exit(1);
-    }
+    RouterMatch match;
+    const bool hasMatch = this->match(method, path, match);
+    if (!hasMatch) return std::nullopt;
 
-    this->router_free(cRouteOpt);
-
-    if (!routeOpt.isMember("id")) return std::nullopt;
+    const bool isTruncated = match.paramsLen > ROUTER_MATCH_PARAMS;
+    if (isTruncated) return this->findSerialized(method, path);
 
+    const char* methods[] = {"GET", "POST", "PUT", "PATCH", "DELETE"};
     std::optional<std::string> methodOpt;
-    if (routeOpt.isMember("method") && !routeOpt["method"].isNull()) {
-      methodOpt = routeOpt["method"].asString();
+    if (match.method) methodOpt = methods[match.method - 1];
+
+    Json::Value params = Json::objectValue;
+    const Segments& keys = this->keys[match.id];
+    for (int i = 0; i < match.paramsLen; ++i) {
+      const char* value = path.data() + match.params[i].start;
+      params[keys[i]] = Json::Value(value, value + match.params[i].length);
     }
 
-    Route route(routeOpt["id"].asInt(), methodOpt, routeOpt["params"],
-                routeOpt["pattern"].asString());
+    const bool isRaw = this->raws.contains(match.id);
+    Route route(match.id, methodOpt, params, this->patterns[match.id], isRaw);
     return route;
   }
 
+  /* Looks the route up through the binary entry point of the library,
+     which fills "match" without allocating. */
+  bool match(const std::string& method, const std::string& path,
+             RouterMatch& match) {
+    return this->router_match(method.c_str(), path.c_str(), &match) >= 0;
+  }
+
+  /* Cache policy of a route, or nullptr when its responses aren't
+     cached. */
+  const RouteCache* getCache(const int& id) const {
+    auto it = this->caches.find(id);
+    const bool hasId = it != this->caches.end();
+    return hasId ? &it->second : nullptr;
+  }
+
   const std::optional<Controller> getController(const int& id) {
     auto it = this->controllers.find(id);
     const bool hasId = it != this->controllers.end();
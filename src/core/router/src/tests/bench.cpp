@@ -0,0 +1,711 @@
+#ifndef ARNELIFY_ROUTER_BENCH_CPP
+#define ARNELIFY_ROUTER_BENCH_CPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <map>
+#include <sstream>
+#include <thread>
+
+#include "json.h"
+
+#include "../cpp/cache/index.cpp"
+#include "../cpp/ffi.cpp"
+#include "../cpp/table/index.cpp"
+
+/* Heap allocations of the process, read around a benchmark to report
+   them per lookup. */
+std::atomic<std::size_t> allocations(0);
+
+void* operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  void* ptr = std::malloc(size ? size : 1);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+/* Route lookup as it was before the route tree: every pattern and the
+   path are split again for every candidate, and routes are copied. Its
+   table was sorted after every registration. */
+class LegacyRouter final {
+ private:
+  std::vector<Route> routes;
+
+  static Segments split(const std::string& string) {
+    Segments segments;
+    std::size_t start = 0;
+    std::size_t end;
+    while ((end = string.find('/', start)) != std::string::npos) {
+      segments.emplace_back(string.substr(start, end - start));
+      start = end + 1;
+    }
+
+    segments.emplace_back(string.substr(start));
+    return segments;
+  }
+
+  static int paramsLen(const Segments& segments) {
+    return std::count_if(
+        segments.begin(), segments.end(),
+        [](const std::string& s) { return !s.empty() && s[0] == ':'; });
+  }
+
+ public:
+  void add(const int& id, const std::string& method,
+           const std::string& pattern) {
+    this->routes.emplace_back(id, method, Json::objectValue, pattern);
+  }
+
+  void sort() {
+    std::sort(this->routes.begin(), this->routes.end(),
+              [](const Route& a, const Route& b) {
+                const Segments segmentsA = split(a.pattern);
+                const Segments segmentsB = split(b.pattern);
+                const int paramsA = paramsLen(segmentsA);
+                const int paramsB = paramsLen(segmentsB);
+                if (paramsA != paramsB) return paramsA < paramsB;
+                return segmentsA.size() < segmentsB.size();
+              });
+  }
+
+  std::optional<Route> find(const std::string& path) {
+    const Segments pathSegments = split(path);
+    for (Route route : this->routes) {
+      const Segments routeSegments = split(route.pattern);
+      if (routeSegments.size() != pathSegments.size()) continue;
+
+      bool isMatch = true;
+      for (std::size_t i = 0; isMatch && i < routeSegments.size(); ++i) {
+        if (routeSegments[i].starts_with(':')) {
+          route.params[routeSegments[i].substr(1)] = pathSegments[i];
+          continue;
+        }
+
+        isMatch = routeSegments[i] == pathSegments[i];
+      }
+
+      if (isMatch) return route;
+    }
+
+    return std::nullopt;
+  }
+};
+
+/* Static segments win over params at every level, a route of the method
+   over an "any" route, and params are captured in pattern order. */
+void checkRouter() {
+  const Controller controller = [](const Ctx& ctx) { return ctx; };
+  ArnelifyRouter router;
+  router.get("/", controller);
+  router.get("/:id", controller);
+  router.get("/users/new", controller);
+  router.post("/users/:id", controller);
+  router.any("/users/:id", controller);
+  router.get("/users/:id/posts/:post", controller);
+  router.delete_("/users/:name/posts/:post", controller);
+  router.get("/files/:name", controller);
+
+  struct Case {
+    const char* method;
+    const char* path;
+    int id;
+    std::string params;
+  };
+
+  const Case cases[] = {
+      {"GET", "/", 0, "{}"},
+      {"GET", "/42", 1, "{\"id\":\"42\"}"},
+      {"GET", "/users/new", 2, "{}"},
+      {"POST", "/users/new", 3, "{\"id\":\"new\"}"},
+      {"HEAD", "/users/7", 4, "{\"id\":\"7\"}"},
+      {"GET", "/users/7/posts/9", 5, "{\"id\":\"7\",\"post\":\"9\"}"},
+      {"DELETE", "/users/ann/posts/9", 6, "{\"name\":\"ann\",\"post\":\"9\"}"},
+      {"PUT", "/users/ann/posts/9", -1, ""},
+      {"GET", "/files/", 7, "{\"name\":\"\"}"},
+      {"GET", "/files/a/b", -1, ""},
+      {"POST", "/", -1, ""}};
+
+  Json::StreamWriterBuilder writer;
+  writer["indentation"] = "";
+  for (const Case& test : cases) {
+    const std::optional<Route> route = router.find(test.method, test.path);
+    const int id = route ? route->id : -1;
+    const std::string params =
+        route ? Json::writeString(writer, route->params) : "";
+    if (id != test.id || params != test.params) {
+      std::cout << "Route mismatch for " << test.method << " " << test.path
+                << ": " << id << " " << params << std::endl;
+      exit(1);
+    }
+  }
+}
+
+/* "count" routes of an API with a few resources per version, each with
+   a collection, an item and a nested item route. */
+std::vector<std::string> makePatterns(const int& count) {
+  std::vector<std::string> patterns;
+  for (int i = 0; static_cast<int>(patterns.size()) < count; ++i) {
+    const std::string resource =
+        "/api/v" + std::to_string(i % 4 + 1) + "/resource" + std::to_string(i);
+    patterns.emplace_back(resource);
+    patterns.emplace_back(resource + "/:id");
+    patterns.emplace_back(resource + "/:id/items/:item");
+  }
+
+  patterns.resize(count);
+  return patterns;
+}
+
+std::string toPath(const std::string& pattern, std::mt19937& rng) {
+  std::string path;
+  std::size_t start = 0;
+  while (start <= pattern.length()) {
+    std::size_t end = pattern.find('/', start);
+    if (end == std::string::npos) end = pattern.length();
+    if (start) path += '/';
+    const bool isParam = pattern[start] == ':';
+    path += isParam ? std::to_string(rng() % 100000)
+                    : pattern.substr(start, end - start);
+    start = end + 1;
+  }
+
+  return path;
+}
+
+void benchRouter(const int& count, const int& iterations) {
+  std::mt19937 rng(count);
+  const std::vector<std::string> patterns = makePatterns(count);
+  const Controller controller = [](const Ctx& ctx) { return ctx; };
+
+  const auto buildStart = std::chrono::steady_clock::now();
+  ArnelifyRouter router;
+  for (const std::string& pattern : patterns) router.get(pattern, controller);
+  router.freeze();
+  const std::chrono::duration<double> build =
+      std::chrono::steady_clock::now() - buildStart;
+
+  LegacyRouter legacy;
+  for (int i = 0; i < count; ++i) legacy.add(i, "GET", patterns[i]);
+  legacy.sort();
+
+  std::vector<std::string> paths;
+  std::vector<int> ids;
+  for (int i = 0; i < 1024; ++i) {
+    const int id = rng() % count;
+    paths.emplace_back(toPath(patterns[id], rng));
+    ids.emplace_back(id);
+  }
+
+  for (int i = 0; i < 64; ++i) {
+    const std::optional<Route> route = router.find("GET", paths[i]);
+    const std::optional<Route> legacyRoute = legacy.find(paths[i]);
+    const bool isSame = route && legacyRoute && route->id == ids[i] &&
+                        legacyRoute->id == ids[i] &&
+                        route->params == legacyRoute->params;
+    if (!isSame) {
+      std::cout << "Router mismatch for " << paths[i] << std::endl;
+      exit(1);
+    }
+  }
+
+  std::cout << "router, " << count << " routes: built in "
+            << build.count() * 1e3 << " ms" << std::endl;
+
+  for (const char* mode : {"legacy", "find", "match"}) {
+    const std::string_view label = mode;
+    const int rounds = label == "legacy" ? std::max(64, iterations / count)
+                                         : iterations;
+    std::vector<std::string_view> values;
+    values.reserve(8);
+    std::size_t checksum = 0;
+    const std::size_t allocationsStart = allocations.load();
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i) {
+      const std::string& path = paths[i % paths.size()];
+      if (label == "legacy") {
+        checksum += legacy.find(path)->id;
+        continue;
+      }
+
+      if (label == "find") {
+        checksum += router.find("GET", path)->id;
+        continue;
+      }
+
+      values.clear();
+      checksum += router.match("GET", path, values);
+    }
+
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    const double allocationsTotal = allocations.load() - allocationsStart;
+    if (!checksum) exit(1);
+    std::cout << "router, " << count << " routes, " << label << ": "
+              << elapsed.count() / rounds * 1e9 << " ns/lookup, "
+              << allocationsTotal / rounds << " allocations/lookup"
+              << std::endl;
+  }
+}
+
+/* Registering a route table and freezing it, against the former sort
+   after every registration, which only the smaller tables can afford. */
+void benchBoot() {
+  const Controller controller = [](const Ctx& ctx) { return ctx; };
+  for (const int count : {250, 500, 3000, 10000}) {
+    const std::vector<std::string> patterns = makePatterns(count);
+    const auto start = std::chrono::steady_clock::now();
+    ArnelifyRouter router;
+    for (const std::string& pattern : patterns) {
+      router.get(pattern, controller);
+    }
+
+    router.freeze();
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << "boot, " << count << " routes: frozen "
+              << elapsed.count() * 1e3 << " ms";
+
+    const bool isAffordable = count <= 500;
+    if (isAffordable) {
+      const auto legacyStart = std::chrono::steady_clock::now();
+      LegacyRouter legacy;
+      for (int i = 0; i < count; ++i) {
+        legacy.add(i, "GET", patterns[i]);
+        legacy.sort();
+      }
+
+      const std::chrono::duration<double> legacyElapsed =
+          std::chrono::steady_clock::now() - legacyStart;
+      std::cout << ", sorted per registration " << legacyElapsed.count() * 1e3
+                << " ms";
+    }
+
+    std::cout << std::endl;
+  }
+}
+
+/* Lookups across the library boundary: the JSON string router_find
+   returns, parsed as the wrapper did, against router_match filling a
+   RouterMatch in place. */
+void benchFfi(const int& count, const int& iterations) {
+  std::mt19937 rng(count);
+  std::vector<std::string> patterns = makePatterns(count);
+  router_create();
+  for (std::string& pattern : patterns) router_get(pattern.data());
+
+  std::vector<std::string> paths;
+  for (int i = 0; i < 1024; ++i) {
+    paths.emplace_back(toPath(patterns[rng() % count], rng));
+  }
+
+  for (const bool isBinary : {false, true}) {
+    RouterMatch match;
+    std::size_t checksum = 0;
+    const std::size_t allocationsStart = allocations.load();
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      std::string& path = paths[i % paths.size()];
+      if (isBinary) {
+        checksum += router_match("GET", path.data(), &match);
+        for (int j = 0; j < match.paramsLen; ++j) {
+          checksum += match.params[j].length;
+        }
+
+        continue;
+      }
+
+      const char* cRouteOpt = router_find(const_cast<char*>("GET"),
+                                          path.data());
+      Json::Value routeOpt;
+      Json::CharReaderBuilder reader;
+      std::string errors;
+      std::istringstream iss(cRouteOpt);
+      Json::parseFromStream(reader, iss, &routeOpt, &errors);
+      router_free(cRouteOpt);
+      checksum += routeOpt["id"].asInt();
+      for (const Json::Value& param : routeOpt["params"]) {
+        checksum += param.asString().length();
+      }
+    }
+
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    const double allocationsTotal = allocations.load() - allocationsStart;
+    if (!checksum) exit(1);
+    std::cout << "ffi, " << count << " routes, "
+              << (isBinary ? "router_match" : "router_find + JSON") << ": "
+              << elapsed.count() / iterations * 1e9 << " ns/lookup, "
+              << allocationsTotal / iterations << " allocations/lookup"
+              << std::endl;
+  }
+
+  router_reset();
+}
+
+Json::Value echo(const Ctx& ctx) { return ctx; }
+
+/* Static pages and collections of an API, with the item routes the table
+   leaves to the dynamic router. */
+constexpr StaticRoute ROUTES[] = {
+    {"GET", "/", echo},
+    {"GET", "/health", echo},
+    {"GET", "/login", echo},
+    {"POST", "/login", echo},
+    {"POST", "/logout", echo},
+    {"", "/webhooks/stripe", echo, true},
+    {"GET", "/api/v1/users", echo},
+    {"POST", "/api/v1/users", echo},
+    {"GET", "/api/v1/users/:id", echo},
+    {"PATCH", "/api/v1/users/:id", echo},
+    {"DELETE", "/api/v1/users/:id", echo},
+    {"GET", "/api/v1/users/me", echo},
+    {"GET", "/api/v1/orders", echo},
+    {"POST", "/api/v1/orders", echo},
+    {"GET", "/api/v1/orders/:id", echo},
+    {"GET", "/api/v1/orders/:id/items/:item", echo},
+    {"GET", "/api/v1/products", echo},
+    {"GET", "/api/v1/products/featured", echo},
+    {"GET", "/api/v1/products/:id", echo},
+    {"GET", "/api/v1/categories", echo},
+    {"GET", "/api/v1/cart", echo},
+    {"PUT", "/api/v1/cart", echo},
+    {"DELETE", "/api/v1/cart", echo},
+    {"GET", "/api/v1/settings", echo},
+    {"PATCH", "/api/v1/settings", echo},
+    {"GET", "/api/v2/users", echo},
+    {"GET", "/api/v2/orders", echo},
+    {"GET", "/api/v2/products", echo},
+    {"GET", "/docs", echo},
+    {"GET", "/docs/openapi.json", echo},
+    {"GET", "/metrics", echo},
+    {"GET", "/robots.txt", echo}};
+
+constexpr ArnelifyRouteTable routeTable(ROUTES);
+
+static_assert(routeTable.find("GET", "/api/v1/users/me")->pattern ==
+              "/api/v1/users/me");
+static_assert(routeTable.find("HEAD", "/webhooks/stripe")->isRaw);
+static_assert(!routeTable.find("GET", "/api/v1/users/7"));
+
+/* Every static route of the table is found there for its method and
+   nowhere else, and every route resolves the same through the dynamic
+   router it was installed into. */
+void checkTable() {
+  ArnelifyRouter router;
+  routeTable.install(router);
+
+  for (const StaticRoute& route : ROUTES) {
+    const std::string_view method = route.method.empty() ? "PUT" : route.method;
+    const bool isStatic = route.pattern.find(':') == std::string_view::npos;
+    const StaticRoute* found = routeTable.find(method, route.pattern);
+    const bool isFound = found && found->pattern == route.pattern &&
+                         found->method == route.method;
+    if (isFound != isStatic || (!isStatic && found)) {
+      std::cout << "Table mismatch for " << route.pattern << std::endl;
+      exit(1);
+    }
+
+    const std::optional<Route> dynamic =
+        router.find(std::string(method), std::string(route.pattern));
+    if (!dynamic || dynamic->pattern != route.pattern ||
+        dynamic->isRaw != route.isRaw) {
+      std::cout << "Installed route mismatch for " << route.pattern
+                << std::endl;
+      exit(1);
+    }
+  }
+
+  for (const char* path : {"/api/v1/user", "/api/v1/users/", "/health/", ""}) {
+    if (routeTable.find("GET", path)) {
+      std::cout << "Table matched " << path << std::endl;
+      exit(1);
+    }
+  }
+
+  if (routeTable.find("POST", "/health")) {
+    std::cout << "Table matched another method" << std::endl;
+    exit(1);
+  }
+}
+
+/* Static paths looked up in the compiled table, against the segment tree
+   of the dynamic router. */
+void benchTable(const int& iterations) {
+  ArnelifyRouter router;
+  routeTable.install(router);
+  std::vector<std::pair<std::string, std::string>> requests;
+  for (const StaticRoute& route : ROUTES) {
+    if (route.pattern.find(':') != std::string_view::npos) continue;
+    const std::string_view method = route.method.empty() ? "GET" : route.method;
+    requests.emplace_back(method, route.pattern);
+  }
+
+  for (const bool isTable : {true, false}) {
+    std::vector<std::string_view> values;
+    std::size_t checksum = 0;
+    const std::size_t allocationsStart = allocations.load();
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      const auto& [method, path] = requests[i % requests.size()];
+      if (isTable) {
+        checksum += routeTable.find(method, path)->pattern.length();
+        continue;
+      }
+
+      values.clear();
+      checksum += router.match(method, path, values) + 1;
+    }
+
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    const double allocationsTotal = allocations.load() - allocationsStart;
+    if (!checksum) exit(1);
+    std::cout << "table, " << requests.size() << " static routes, "
+              << (isTable ? "compiled" : "segment tree") << ": "
+              << elapsed.count() / iterations * 1e9 << " ns/lookup, "
+              << allocationsTotal / iterations << " allocations/lookup"
+              << std::endl;
+  }
+}
+
+/* Request with the getters the route cache builds its keys from. */
+struct CacheReq {
+  std::string method;
+  std::string path;
+  std::map<std::string, std::string, std::less<>> query;
+  std::map<std::string, std::string, std::less<>> headers;
+
+  std::string_view getMethod() const { return this->method; }
+  std::string_view getPath() const { return this->path; }
+
+  std::string_view getQuery(const std::string_view& key) const {
+    auto it = this->query.find(key);
+    return it == this->query.end() ? std::string_view() : it->second;
+  }
+
+  std::string_view getHeader(const std::string_view& key) const {
+    auto it = this->headers.find(key);
+    return it == this->headers.end() ? std::string_view() : it->second;
+  }
+};
+
+void expect(const bool isTrue, const std::string& message) {
+  if (isTrue) return;
+  std::cout << "Route cache: " << message << std::endl;
+  exit(1);
+}
+
+/* Caches "body" the way a 200 from a controller is cached. */
+void store(ArnelifyRouteCache& cache, const std::string& key,
+           const RouteCache& policy, const std::string& body) {
+  cache.fetch(key, policy, [&body]() {
+    return ArnelifyRouteCache::Response{200, body};
+  });
+}
+
+/* Keys follow the selected query params and headers only; TTL, tags and
+   the byte budget drop what they should and nothing else. Only a 200 is
+   cached, and nothing rendered across an invalidate() of its tags. */
+void checkCache() {
+  ArnelifyRouteCache cache(16 * 4096);
+  const RouteCache users{0, {"page"}, {"Accept-Language"}, {"users"}};
+  const RouteCache orders{0, {}, {}, {"orders", "users"}};
+  std::string key;
+  std::string other;
+
+  CacheReq req{"GET", "/users", {{"page", "1"}, {"utm", "a"}}, {}};
+  ArnelifyRouteCache::setKey(key, users, req);
+  req.query["utm"] = "b";
+  ArnelifyRouteCache::setKey(other, users, req);
+  expect(key == other, "an unselected query param changed the key");
+  req.query["page"] = "2";
+  ArnelifyRouteCache::setKey(other, users, req);
+  expect(key != other, "a selected query param didn't change the key");
+  req.query["page"] = "1";
+  req.headers["Accept-Language"] = "de";
+  ArnelifyRouteCache::setKey(other, users, req);
+  expect(key != other, "a selected header didn't change the key");
+
+  /* Lengths keep values that contain the separator apart. */
+  const RouteCache pair{0, {"a", "b"}, {}, {}};
+  ArnelifyRouteCache::setKey(key, pair, CacheReq{"GET", "/", {{"a", "1:1"}}});
+  ArnelifyRouteCache::setKey(other, pair,
+                             CacheReq{"GET", "/", {{"a", "1"}, {"b", "1"}}});
+  expect(key != other, "two requests share a key");
+
+  for (int i = 0; i < 64; ++i) {
+    const std::string path = "/users/" + std::to_string(i);
+    store(cache, path, users, "user " + std::to_string(i));
+    store(cache, path + "/orders", orders, "orders");
+    store(cache, path + "/avatar", {0, {}, {}, {"avatars"}}, "avatar");
+  }
+
+  const ArnelifyRouteCache::Bytes user = cache.get("/users/7");
+  expect(user && user->body == "user 7", "a response wasn't cached");
+  cache.invalidate("orders");
+  expect(!cache.get("/users/7/orders"), "a tagged response survived");
+  expect(cache.get("/users/7") != nullptr,
+         "an untagged response was dropped");
+  cache.invalidate("users");
+  for (int i = 0; i < 64; ++i) {
+    const std::string path = "/users/" + std::to_string(i);
+    expect(!cache.get(path), "a response with a tag survived");
+    expect(cache.get(path + "/avatar") != nullptr, "another tag was dropped");
+  }
+
+  int renders = 0;
+  const auto render = [&renders](const int& code) {
+    renders++;
+    Json::Value response;
+    response["code"] = code;
+    response["error"] = "Not found.";
+    const int status = ArnelifyRouteCache::getCode(response);
+    return ArnelifyRouteCache::Response{status, response.toStyledString()};
+  };
+
+  for (int i = 0; i < 2; ++i) {
+    const ArnelifyRouteCache::Bytes missing =
+        cache.fetch("/missing", users, [&render]() { return render(404); });
+    expect(missing->code == 404, "an error response lost its code");
+  }
+
+  expect(renders == 2, "an error response was cached");
+  for (int i = 0; i < 2; ++i) {
+    cache.fetch("/found", users, [&render]() { return render(200); });
+  }
+
+  expect(renders == 3, "a response wasn't cached after a miss");
+  expect(ArnelifyRouteCache::getCode(Json::Value("code")) == 200,
+         "a response without a code isn't a 200");
+
+  cache.fetch("/stale", users, [&cache]() {
+    cache.invalidate("users");
+    return ArnelifyRouteCache::Response{200, "stale"};
+  });
+
+  expect(!cache.get("/stale"), "a response older than its tags was cached");
+  store(cache, "/fresh", users, "fresh");
+  expect(cache.get("/fresh") != nullptr, "an invalidated tag stuck");
+
+  store(cache, "/once", {1, {}, {}, {}}, "once");
+  expect(cache.get("/once") != nullptr, "a fresh response expired");
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+  expect(!cache.get("/once"), "a response outlived its TTL");
+
+  store(cache, "/large", users, std::string(2048, 'x'));
+  expect(!cache.get("/large"), "a response over a quarter of a shard");
+
+  cache.setCapacity(0);
+  store(cache, "/off", users, "off");
+  expect(!cache.get("/off"), "a response was cached without a budget");
+  cache.setCapacity(16 * 4096);
+
+  cache.clear();
+  const std::string body(512, 'x');
+  for (int i = 0; i < 4096; ++i) {
+    store(cache, "/page/" + std::to_string(i), users, body);
+  }
+
+  int hits = 0;
+  for (int i = 0; i < 4096; ++i) {
+    hits += cache.get("/page/" + std::to_string(i)) != nullptr;
+  }
+
+  expect(hits * (body.length() + 10) <= 16 * 4096, "the budget was exceeded");
+  expect(cache.get("/page/4095") != nullptr,
+         "the newest response was evicted");
+  expect(!cache.get("/page/0"), "the oldest response wasn't evicted");
+}
+
+/* Hits on a warm cache from several threads at once, next to the
+   controller and serialization a hit saves. */
+void benchCache(const int& iterations) {
+  ArnelifyRouteCache cache(64 * 1048576);
+  const RouteCache policy{60, {"page"}, {}, {"products"}};
+  std::vector<CacheReq> requests;
+  for (int i = 0; i < 1024; ++i) {
+    CacheReq req{"GET", "/api/v1/products/" + std::to_string(i)};
+    req.query["page"] = std::to_string(i % 8);
+    requests.push_back(std::move(req));
+  }
+
+  std::string key;
+  for (const CacheReq& req : requests) {
+    Json::Value response;
+    response["id"] = req.path;
+    response["page"] = req.query.at("page");
+    response["tags"].append("new");
+    ArnelifyRouteCache::setKey(key, policy, req);
+    store(cache, key, policy, Json::FastWriter().write(response));
+  }
+
+  const std::size_t allocationsStart = allocations.load();
+  const auto start = std::chrono::steady_clock::now();
+  std::size_t checksum = 0;
+  for (int i = 0; i < iterations; ++i) {
+    const CacheReq& req = requests[i % requests.size()];
+    Json::Value response;
+    response["id"] = req.path;
+    response["page"] = req.query.at("page");
+    response["tags"].append("new");
+    checksum += Json::FastWriter().write(response).length();
+  }
+
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  const double allocationsTotal = allocations.load() - allocationsStart;
+  std::cout << "cache, controller and serialization: "
+            << elapsed.count() / iterations * 1e9 << " ns/request, "
+            << allocationsTotal / iterations << " allocations/request"
+            << std::endl;
+
+  if (!checksum) exit(1);
+  std::atomic<std::size_t> misses(0);
+  for (const int threadsLen : {1, 4, 8}) {
+    std::vector<std::thread> threads;
+    const auto threadsStart = std::chrono::steady_clock::now();
+    for (int t = 0; t < threadsLen; ++t) {
+      threads.emplace_back([&, t] {
+        thread_local std::string key;
+        for (int i = 0; i < iterations; ++i) {
+          const CacheReq& req = requests[(i * 7 + t) % requests.size()];
+          ArnelifyRouteCache::setKey(key, policy, req);
+          if (!cache.get(key)) misses++;
+        }
+      });
+    }
+
+    for (std::thread& thread : threads) thread.join();
+    const std::chrono::duration<double> threadsElapsed =
+        std::chrono::steady_clock::now() - threadsStart;
+    std::cout << "cache, " << threadsLen << " threads, hits: "
+              << threadsElapsed.count() / iterations / threadsLen * 1e9
+              << " ns/lookup" << std::endl;
+  }
+
+  if (misses) exit(1);
+}
+
+int main(int argc, char* argv[]) {
+  const int iterations = argc > 1 ? std::stoi(argv[1]) : 1000000;
+  checkRouter();
+  checkTable();
+  checkCache();
+  benchBoot();
+  benchRouter(1000, iterations);
+  benchRouter(10000, iterations);
+  benchFfi(1000, iterations / 10);
+  benchTable(iterations * 10);
+  benchCache(iterations);
+  return 0;
+}
+
+#endif
\ No newline at end of file
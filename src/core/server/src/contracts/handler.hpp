@@ -7,6 +7,8 @@
 
 #include "json.h"
 
+#include "../cpp/writer/index.cpp"
+
 using ArnelifyServerCallback =
     std::function<void(const std::string&, const bool&)>;
 using ArnelifyServerReq = Json::Value;
@@ -44,6 +46,12 @@ struct ArnelifyServerRes {
     this->res["body"] = this->res["body"].asString() + chunk;
   }
 
+  void addJson(const Json::Value& json) {
+    std::string chunk;
+    ArnelifyWriter::write(json, chunk);
+    this->addBody(chunk);
+  }
+
   void end() {
     const std::string filePath = this->res["filePath"].asString();
     const bool hasFile = !filePath.empty();
@@ -88,10 +96,9 @@ struct ArnelifyServerRes {
   }
 
   const std::string serialize() {
-    Json::StreamWriterBuilder writer;
-    writer["indentation"] = "";
-
-    return Json::writeString(writer, this->res);
+    std::string serialized;
+    ArnelifyWriter::write(this->res, serialized);
+    return serialized;
   }
 };
 
@@ -9,34 +9,64 @@ struct ArnelifyServerOpts final {
   const std::size_t SERVER_BLOCK_SIZE_KB;
   const std::string SERVER_CHARSET;
   const bool SERVER_GZIP;
+  const std::size_t SERVER_GZIP_CACHE_MB;
+  const int SERVER_GZIP_LEVEL;
+  const std::size_t SERVER_GZIP_THRESHOLD;
+  const std::string SERVER_IO_MODEL;
+  const int SERVER_KEEP_ALIVE;
   const bool SERVER_KEEP_EXTENSIONS;
   const int SERVER_MAX_FIELDS;
   const std::size_t SERVER_MAX_FIELDS_SIZE_TOTAL_MB;
   const int SERVER_MAX_FILES;
   const std::size_t SERVER_MAX_FILES_SIZE_TOTAL_MB;
   const std::size_t SERVER_MAX_FILE_SIZE_MB;
+  const int SERVER_MAX_REQUESTS;
   const int SERVER_PORT;
   const int SERVER_QUEUE_LIMIT;
+  const int SERVER_SLAB_LIMIT;
+  const int SERVER_THREAD_LIMIT;
+  const std::size_t SERVER_UPLOAD_BUFFER_KB;
   const std::filesystem::path SERVER_UPLOAD_DIR;
+  const bool SERVER_UPLOAD_DIRECT;
+  const bool SERVER_UPLOAD_PREALLOCATE;
+  const int SERVER_WORKERS;
 
   ArnelifyServerOpts(const bool &a, const int &b, const std::string &c,
                      const bool &g, const bool &k, const int &mfd,
                      const int &mfdst, const int &mfl, const int &mflst,
                      const int &mfls, const int &p, const int &q,
-                     const std::string &u = "./src/storage/upload")
+                     const std::string &u = "./src/storage/upload",
+                     const std::string &io = "thread", const int &t = 0,
+                     const int &ka = 5, const int &mr = 1000,
+                     const int &w = 1, const int &ub = 1024,
+                     const bool &ud = false, const bool &up = true,
+                     const int &gl = 6, const int &gt = 96,
+                     const int &gc = 64, const int &sl = 1024)
       : SERVER_ALLOW_EMPTY_FILES(a),
         SERVER_BLOCK_SIZE_KB(b),
         SERVER_CHARSET(c),
         SERVER_GZIP(g),
+        SERVER_GZIP_CACHE_MB(gc),
+        SERVER_GZIP_LEVEL(gl),
+        SERVER_GZIP_THRESHOLD(gt),
+        SERVER_IO_MODEL(io),
+        SERVER_KEEP_ALIVE(ka),
         SERVER_KEEP_EXTENSIONS(k),
         SERVER_MAX_FIELDS(mfd),
         SERVER_MAX_FIELDS_SIZE_TOTAL_MB(mfdst),
         SERVER_MAX_FILES(mfl),
         SERVER_MAX_FILES_SIZE_TOTAL_MB(mflst),
         SERVER_MAX_FILE_SIZE_MB(mfls),
+        SERVER_MAX_REQUESTS(mr),
         SERVER_PORT(p),
         SERVER_QUEUE_LIMIT(q),
-        SERVER_UPLOAD_DIR(u) {};
+        SERVER_SLAB_LIMIT(sl),
+        SERVER_THREAD_LIMIT(t),
+        SERVER_UPLOAD_BUFFER_KB(ub),
+        SERVER_UPLOAD_DIR(u),
+        SERVER_UPLOAD_DIRECT(ud),
+        SERVER_UPLOAD_PREALLOCATE(up),
+        SERVER_WORKERS(w) {};
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,61 @@
+#ifndef ARNELIFY_SERVER_SESSION_HPP
+#define ARNELIFY_SERVER_SESSION_HPP
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "../receiver/index.cpp"
+#include "../transmitter/index.cpp"
+
+struct ArnelifyServerWorker;
+
+struct ArnelifyServerSession final {
+  int socket;
+  std::string client;
+  ArnelifyReceiver *receiver;
+  ArnelifyTransmitter *transmitter;
+  int requests;
+  std::chrono::steady_clock::time_point activity;
+
+  std::vector<char> block;
+  std::size_t index;
+  int signal;
+  ArnelifyServerWorker *worker;
+
+  ArnelifyServerSession(const int &s, const std::string &c,
+                        ArnelifyReceiver *r, ArnelifyTransmitter *t)
+      : socket(s),
+        client(c),
+        receiver(r),
+        transmitter(t),
+        requests(0),
+        activity(std::chrono::steady_clock::now()),
+        index(0),
+        signal(0),
+        worker(nullptr) {};
+
+  ~ArnelifyServerSession() {
+    delete this->receiver;
+    delete this->transmitter;
+  }
+
+  /* Hands a session recycled by the slab to a new connection. */
+  void open(const int &s, const std::string &c) {
+    this->socket = s;
+    this->client = c;
+    this->requests = 0;
+    this->activity = std::chrono::steady_clock::now();
+    this->receiver->setClient(c);
+    this->transmitter->setSocket(s);
+  }
+
+  /* Drops the state of the closed connection, keeping the buffers. */
+  void recycle() {
+    this->receiver->recycle();
+    this->transmitter->recycle();
+    this->worker = nullptr;
+  }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef ARNELIFY_SERVER_WORKER_HPP
+#define ARNELIFY_SERVER_WORKER_HPP
+
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include "../pool/index.cpp"
+#include "../slab/index.cpp"
+
+#include "session.hpp"
+
+struct ArnelifyServerWorker final {
+  const int serverSocket;
+  const int epollFd;
+  const int eventFd;
+  ArnelifyPool *pool;
+  ArnelifySlab *slab;
+  std::vector<char> block;
+  std::vector<ArnelifyServerSession *> sessions;
+
+  std::mutex mtx;
+  std::vector<ArnelifyServerSession *> returned;
+  std::vector<ArnelifyServerSession *> rearmed;
+
+  ArnelifyServerWorker(const int &s, const int &e, const int &ev,
+                       ArnelifyPool *p, ArnelifySlab *sl,
+                       const std::size_t &blockSize)
+      : serverSocket(s),
+        epollFd(e),
+        eventFd(ev),
+        pool(p),
+        slab(sl),
+        block(blockSize) {};
+};
+
+#endif
\ No newline at end of file
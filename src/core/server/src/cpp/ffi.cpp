@@ -7,6 +7,9 @@ extern "C" {
 
 ArnelifyServer *server = nullptr;
 
+/* Request of the handler running on this thread. */
+thread_local const ArnelifyServerReq *handled = nullptr;
+
 void server_create(const char *cOpts) {
   Json::Value json;
   Json::CharReaderBuilder reader;
@@ -132,6 +135,55 @@ void server_create(const char *cOpts) {
                             json["SERVER_UPLOAD_DIR"].isString();
   if (!hasUploadDir) json["SERVER_UPLOAD_DIR"] = "./src/storage/upload";
 
+  const bool hasIoModel =
+      json.isMember("SERVER_IO_MODEL") && json["SERVER_IO_MODEL"].isString();
+  if (!hasIoModel) json["SERVER_IO_MODEL"] = "thread";
+
+  const bool hasThreadLimit = json.isMember("SERVER_THREAD_LIMIT") &&
+                              json["SERVER_THREAD_LIMIT"].isInt();
+  if (!hasThreadLimit) json["SERVER_THREAD_LIMIT"] = 0;
+
+  const bool hasKeepAlive =
+      json.isMember("SERVER_KEEP_ALIVE") && json["SERVER_KEEP_ALIVE"].isInt();
+  if (!hasKeepAlive) json["SERVER_KEEP_ALIVE"] = 5;
+
+  const bool hasMaxRequests = json.isMember("SERVER_MAX_REQUESTS") &&
+                              json["SERVER_MAX_REQUESTS"].isInt();
+  if (!hasMaxRequests) json["SERVER_MAX_REQUESTS"] = 1000;
+
+  const bool hasWorkers =
+      json.isMember("SERVER_WORKERS") && json["SERVER_WORKERS"].isInt();
+  if (!hasWorkers) json["SERVER_WORKERS"] = 1;
+
+  const bool hasUploadBuffer = json.isMember("SERVER_UPLOAD_BUFFER_KB") &&
+                               json["SERVER_UPLOAD_BUFFER_KB"].isInt();
+  if (!hasUploadBuffer) json["SERVER_UPLOAD_BUFFER_KB"] = 1024;
+
+  const bool hasUploadDirect = json.isMember("SERVER_UPLOAD_DIRECT") &&
+                               json["SERVER_UPLOAD_DIRECT"].isBool();
+  if (!hasUploadDirect) json["SERVER_UPLOAD_DIRECT"] = false;
+
+  const bool hasUploadPreallocate =
+      json.isMember("SERVER_UPLOAD_PREALLOCATE") &&
+      json["SERVER_UPLOAD_PREALLOCATE"].isBool();
+  if (!hasUploadPreallocate) json["SERVER_UPLOAD_PREALLOCATE"] = true;
+
+  const bool hasGzipLevel =
+      json.isMember("SERVER_GZIP_LEVEL") && json["SERVER_GZIP_LEVEL"].isInt();
+  if (!hasGzipLevel) json["SERVER_GZIP_LEVEL"] = 6;
+
+  const bool hasGzipThreshold = json.isMember("SERVER_GZIP_THRESHOLD") &&
+                                json["SERVER_GZIP_THRESHOLD"].isInt();
+  if (!hasGzipThreshold) json["SERVER_GZIP_THRESHOLD"] = 96;
+
+  const bool hasGzipCache = json.isMember("SERVER_GZIP_CACHE_MB") &&
+                            json["SERVER_GZIP_CACHE_MB"].isInt();
+  if (!hasGzipCache) json["SERVER_GZIP_CACHE_MB"] = 64;
+
+  const bool hasSlabLimit =
+      json.isMember("SERVER_SLAB_LIMIT") && json["SERVER_SLAB_LIMIT"].isInt();
+  if (!hasSlabLimit) json["SERVER_SLAB_LIMIT"] = 1024;
+
   ArnelifyServerOpts opts(
       json["SERVER_ALLOW_EMPTY_FILES"].asBool(),
       json["SERVER_BLOCK_SIZE_KB"].asInt(), json["SERVER_CHARSET"].asString(),
@@ -141,23 +193,41 @@ void server_create(const char *cOpts) {
       json["SERVER_MAX_FILES"].asInt(),
       json["SERVER_MAX_FILES_SIZE_TOTAL_MB"].asInt(),
       json["SERVER_MAX_FILE_SIZE_MB"].asInt(), json["SERVER_PORT"].asInt(),
-      json["SERVER_QUEUE_LIMIT"].asInt(), json["SERVER_UPLOAD_DIR"].asString());
+      json["SERVER_QUEUE_LIMIT"].asInt(), json["SERVER_UPLOAD_DIR"].asString(),
+      json["SERVER_IO_MODEL"].asString(), json["SERVER_THREAD_LIMIT"].asInt(),
+      json["SERVER_KEEP_ALIVE"].asInt(), json["SERVER_MAX_REQUESTS"].asInt(),
+      json["SERVER_WORKERS"].asInt(), json["SERVER_UPLOAD_BUFFER_KB"].asInt(),
+      json["SERVER_UPLOAD_DIRECT"].asBool(),
+      json["SERVER_UPLOAD_PREALLOCATE"].asBool(),
+      json["SERVER_GZIP_LEVEL"].asInt(), json["SERVER_GZIP_THRESHOLD"].asInt(),
+      json["SERVER_GZIP_CACHE_MB"].asInt(), json["SERVER_SLAB_LIMIT"].asInt());
 
   server = new ArnelifyServer(opts);
 }
 
 void server_destroy() { server = nullptr; }
 
+/* Body of the request the handler runs for, parsed only now, so a route
+   that takes it raw or doesn't exist never pays for it. Null when its
+   JSON is invalid; the string lives until the next call on the thread. */
+const char *server_get_body() {
+  if (!handled->isValidBody()) return nullptr;
+
+  thread_local std::string body;
+  body.clear();
+  ArnelifyWriter::write(handled->getBody(), body);
+  return body.c_str();
+}
+
 void server_set_handler(const char *(*cHandler)(const char *),
                         const int hasRemove) {
   server->setHandler([cHandler, hasRemove](const ArnelifyServerReq &req, ArnelifyServerRes res) -> void {
-    Json::StreamWriterBuilder writer;
-    writer["indentation"] = "";
-    writer["emitUTF8"] = true;
-
-    const std::string request = Json::writeString(writer, req);
+    /* JSON and urlencoded bodies go as received, see server_get_body(). */
+    const std::string &request = ArnelifyWriter::stringify(req.toJson(true));
     const char *cReq = request.c_str();
+    handled = &req;
     const char *cRes = cHandler(cReq);
+    handled = nullptr;
     if (cRes == nullptr) {
       std::cout << "[ArnelifyServer FFI]: C error: cRes must be a valid JSON."
                 << std::endl;
@@ -2,15 +2,28 @@
 #define ARNELIFY_SERVER_CPP
 
 #include <arpa/inet.h>
+#include <atomic>
+#include <csignal>
+#include <fcntl.h>
 #include <functional>
 #include <iostream>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <thread>
 #include <unistd.h>
+#include <vector>
 
+#include "pool/index.cpp"
 #include "receiver/index.cpp"
+#include "slab/index.cpp"
 #include "transmitter/index.cpp"
 
 #include "contracts/opts.hpp"
+#include "contracts/session.hpp"
+#include "contracts/worker.hpp"
 
 using ArnelifyServerRes = ArnelifyTransmitter *;
 using ArnelifyServerCallback =
@@ -21,6 +34,7 @@ using ArnelifyServerHandler =
 class ArnelifyServer {
  private:
   const ArnelifyServerOpts opts;
+  ArnelifyCache cache;
   ArnelifyServerCallback callback = [](const std::string &message,
                                        const bool &isError) -> void {
     if (isError) {
@@ -33,110 +47,543 @@ class ArnelifyServer {
 
   ArnelifyServerHandler handler = [](const ArnelifyServerReq &req,
                                      ArnelifyServerRes res) -> void {
-    Json::StreamWriterBuilder writer;
-    writer["indentation"] = "";
-    writer["emitUTF8"] = true;
-
     Json::Value json;
     json["code"] = 200;
     json["success"] = "Welcome to Arnelify Server";
-    res->addBody(Json::writeString(writer, json));
+    res->addJson(json);
     res->end();
   };
 
-  bool isRunning;
+  std::atomic<bool> isRunning;
+  std::once_flag isShutdown;
+  std::string unavailable;
   sockaddr_in serverAddr;
-  int serverSocket;
+  std::vector<int> serverSockets;
 
-  void read(const int &clientSocket, sockaddr_in &clientAddr) {
-    char client[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, &clientAddr.sin_addr, client, INET_ADDRSTRLEN);
-    const std::size_t BLOCK_SIZE = this->opts.SERVER_BLOCK_SIZE_KB * 1024;
-    const std::string SERVER_CLIENT = std::string(client);
-    ArnelifyTransmitterOpts transmitterOpts(
-        this->opts.SERVER_BLOCK_SIZE_KB, this->opts.SERVER_CHARSET,
-        this->opts.SERVER_GZIP, SERVER_CLIENT);
-    ArnelifyTransmitter *res =
-        new ArnelifyTransmitter(clientSocket, transmitterOpts);
+  ArnelifyReceiver *createReceiver(const std::string &client) {
     ArnelifyReceiverOpts opts(
-        this->opts.SERVER_ALLOW_EMPTY_FILES, SERVER_CLIENT,
+        this->opts.SERVER_ALLOW_EMPTY_FILES, client,
         this->opts.SERVER_KEEP_EXTENSIONS, this->opts.SERVER_MAX_FIELDS,
         this->opts.SERVER_MAX_FIELDS_SIZE_TOTAL_MB, this->opts.SERVER_MAX_FILES,
         this->opts.SERVER_MAX_FILES_SIZE_TOTAL_MB,
-        this->opts.SERVER_MAX_FILE_SIZE_MB, this->opts.SERVER_UPLOAD_DIR);
-    ArnelifyReceiver *receiver = new ArnelifyReceiver(opts);
+        this->opts.SERVER_MAX_FILE_SIZE_MB, this->opts.SERVER_UPLOAD_DIR,
+        this->opts.SERVER_UPLOAD_BUFFER_KB, this->opts.SERVER_UPLOAD_DIRECT,
+        this->opts.SERVER_UPLOAD_PREALLOCATE,
+        this->opts.SERVER_IO_MODEL == "epoll");
+    return new ArnelifyReceiver(opts);
+  }
 
-    ssize_t bytesRead = 0;
-    char *block = new char[BLOCK_SIZE];
-    int SIGNAL_ON_BLOCK = 0;
-    while ((bytesRead = recv(clientSocket, block, BLOCK_SIZE, 0)) > 0) {
-      SIGNAL_ON_BLOCK = receiver->onBlock(block, bytesRead);
-      if (SIGNAL_ON_BLOCK > 0) break;
+  ArnelifyTransmitter *createTransmitter(const int &clientSocket,
+                                         const std::string &client) {
+    ArnelifyTransmitterOpts opts(this->opts.SERVER_BLOCK_SIZE_KB,
+                                 this->opts.SERVER_CHARSET,
+                                 this->opts.SERVER_GZIP, client,
+                                 this->opts.SERVER_GZIP_LEVEL,
+                                 this->opts.SERVER_GZIP_THRESHOLD);
+    return new ArnelifyTransmitter(clientSocket, opts, &this->cache);
+  }
+
+  /* Takes a session from the slab, or creates one when the slab has none
+     left. */
+  ArnelifyServerSession *createSession(ArnelifySlab *slab,
+                                       const int &clientSocket,
+                                       const std::string &client) {
+    ArnelifyServerSession *session = slab->acquire();
+    if (session) {
+      session->open(clientSocket, client);
+      return session;
     }
 
-    delete[] block;
+    return new ArnelifyServerSession(
+        clientSocket, client, this->createReceiver(client),
+        this->createTransmitter(clientSocket, client));
+  }
+
+  const std::string getClient(sockaddr_in &clientAddr) {
+    char client[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &clientAddr.sin_addr, client, INET_ADDRSTRLEN);
+    return std::string(client);
+  }
+
+  bool isKeepAlive(ArnelifyServerSession *session,
+                   const int &SIGNAL_ON_BLOCK) {
+    const bool isEnabled = this->opts.SERVER_KEEP_ALIVE > 0;
+    if (!isEnabled || SIGNAL_ON_BLOCK != 2) return false;
+
+    const bool isMaxRequests =
+        this->opts.SERVER_MAX_REQUESTS > 0 &&
+        session->requests >= this->opts.SERVER_MAX_REQUESTS;
+    if (isMaxRequests) return false;
+    return session->receiver->isKeepAlive();
+  }
+
+  void respond(ArnelifyReceiver *receiver, ArnelifyTransmitter *res,
+               const int &SIGNAL_ON_BLOCK) {
     const bool isOnBlockError = SIGNAL_ON_BLOCK != 2;
     if (isOnBlockError) {
-      Json::StreamWriterBuilder writer;
-      writer["indentation"] = "";
-      writer["emitUTF8"] = true;
-
       Json::Value json;
       json["code"] = 409;
       json["error"] = receiver->getStatus();
-      const std::string body = Json::writeString(writer, json);
 
       res->setCode(409);
-      res->addBody(body);
+      res->addJson(json);
       res->end();
-
-      delete receiver;
-      delete res;
       return;
     }
 
     res->setCallback(this->callback);
     res->setEncoding(receiver->getEncoding());
-    const ArnelifyServerReq req = receiver->finish();
-    delete receiver;
+    const ArnelifyServerReq &req = receiver->finish();
+    res->setVersion(req.getVersion());
+    const bool isGet = req.getMethod() == "GET";
+    if (isGet) {
+      res->setRange(req.getHeader("Range"), req.getHeader("If-Range"));
+      res->setValidators(req.getHeader("If-None-Match"),
+                         req.getHeader("If-Modified-Since"));
+    }
 
     this->handler(req, res);
+  }
+
+  /* Serves the request the receiver has just completed, then every
+     pipelined request already buffered behind it. Returns false once the
+     connection has to be closed. */
+  bool serve(ArnelifyServerSession *session, int SIGNAL_ON_BLOCK) {
+    while (true) {
+      session->requests += 1;
+      const bool isKeepAlive = this->isKeepAlive(session, SIGNAL_ON_BLOCK);
+      session->transmitter->setKeepAlive(isKeepAlive);
+      this->respond(session->receiver, session->transmitter, SIGNAL_ON_BLOCK);
+
+      const bool isClose = !session->transmitter->getKeepAlive();
+      if (isClose) return false;
+
+      session->transmitter->reset();
+      if (!session->receiver->hasPending()) return true;
+      SIGNAL_ON_BLOCK = session->receiver->onBlock(nullptr, 0);
+      if (session->receiver->isUpload()) {
+        SIGNAL_ON_BLOCK = this->upload(session);
+        if (SIGNAL_ON_BLOCK == 0) return false;
+      }
+
+      if (SIGNAL_ON_BLOCK == 0) return true;
+    }
+  }
+
+  /* Reads the rest of a deferred multipart body with blocking reads, so
+     its files are written on the calling thread. Returns 0 when the peer
+     goes away or stalls before the body is complete. */
+  int upload(ArnelifyServerSession *session) {
+    const bool hasTimeout = this->opts.SERVER_KEEP_ALIVE > 0;
+    if (hasTimeout) {
+      timeval timeout{};
+      timeout.tv_sec = this->opts.SERVER_KEEP_ALIVE;
+      setsockopt(session->socket, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                 sizeof(timeout));
+    }
+
+    const std::size_t BLOCK_SIZE = this->opts.SERVER_BLOCK_SIZE_KB * 1024;
+    session->block.resize(BLOCK_SIZE);
+    char *block = session->block.data();
+    int SIGNAL_ON_BLOCK = session->receiver->onBlock(nullptr, 0);
+    while (SIGNAL_ON_BLOCK == 0) {
+      const ssize_t bytesRead = recv(session->socket, block, BLOCK_SIZE, 0);
+      if (bytesRead > 0) {
+        SIGNAL_ON_BLOCK = session->receiver->onBlock(block, bytesRead);
+        continue;
+      }
+
+      const bool isInterrupted = bytesRead == -1 && errno == EINTR;
+      if (!isInterrupted) return 0;
+    }
+
+    return SIGNAL_ON_BLOCK;
+  }
+
+  void read(ArnelifySlab *slab, const int &clientSocket,
+            const std::string &client) {
+    const bool hasTimeout = this->opts.SERVER_KEEP_ALIVE > 0;
+    if (hasTimeout) {
+      timeval timeout{};
+      timeout.tv_sec = this->opts.SERVER_KEEP_ALIVE;
+      setsockopt(clientSocket, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                 sizeof(timeout));
+    }
+
+    const std::size_t BLOCK_SIZE = this->opts.SERVER_BLOCK_SIZE_KB * 1024;
+    ArnelifyServerSession *session =
+        this->createSession(slab, clientSocket, client);
+    session->block.resize(BLOCK_SIZE);
+    char *block = session->block.data();
+    while (true) {
+      ssize_t bytesRead = 0;
+      int SIGNAL_ON_BLOCK = 0;
+      while ((bytesRead = recv(clientSocket, block, BLOCK_SIZE, 0)) > 0) {
+        SIGNAL_ON_BLOCK = session->receiver->onBlock(block, bytesRead);
+        if (SIGNAL_ON_BLOCK > 0) break;
+      }
+
+      const bool isIdle = SIGNAL_ON_BLOCK == 0 && session->requests > 0 &&
+                          !session->receiver->hasPending();
+      if (isIdle) break;
+
+      const bool isKeepAlive = this->serve(session, SIGNAL_ON_BLOCK);
+      if (!isKeepAlive || SIGNAL_ON_BLOCK == 0) break;
+    }
+
     close(clientSocket);
-    delete res;
+    slab->release(session);
   }
 
-  void acceptor() {
+  int getWorkers() { return std::max(1, this->opts.SERVER_WORKERS); }
+
+  int listener() {
+    const int serverSocket = socket(AF_INET, SOCK_STREAM, 0);
+    const bool isServerSocketCreated = serverSocket != -1;
+    if (!isServerSocketCreated) {
+      this->callback("Socket creation failed.", true);
+      exit(1);
+    }
+
+    int opt = 1;
+    setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    const bool isReusePort = this->getWorkers() > 1;
+    if (isReusePort) {
+      setsockopt(serverSocket, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
+    }
+
+    const bool isBindSuccess =
+        bind(serverSocket, (sockaddr *)&this->serverAddr,
+             sizeof(this->serverAddr)) != -1;
+    if (!isBindSuccess) {
+      this->callback("Bind failed.", true);
+      close(serverSocket);
+      exit(1);
+    }
+
+    const bool isListenSuccess =
+        listen(serverSocket, this->opts.SERVER_QUEUE_LIMIT) != -1;
+    if (!isListenSuccess) {
+      this->callback("Listen failed.", true);
+      close(serverSocket);
+      exit(1);
+    }
+
+    return serverSocket;
+  }
+
+  /* Pins the calling worker to one core, so each listening socket, its
+     event loop and its sessions stay in that core's caches. */
+  void pin(const int &workerId) {
+    const int cores = std::thread::hardware_concurrency();
+    if (cores < 1) return;
+
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(workerId % cores, &cpuset);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+  }
+
+  void shutdown() {
+    std::call_once(this->isShutdown, [this]() {
+      for (const int &serverSocket : this->serverSockets) close(serverSocket);
+      this->callback("Server stopped.", false);
+      exit(0);
+    });
+  }
+
+  void worker(const int &workerId) {
+    const bool isSharded = this->getWorkers() > 1;
+    if (isSharded) this->pin(workerId);
+
+    const int serverSocket = this->serverSockets[workerId];
+    const bool isEpoll = this->opts.SERVER_IO_MODEL == "epoll";
+    if (isEpoll) {
+      this->reactor(serverSocket);
+      return;
+    }
+
+    this->acceptor(serverSocket);
+  }
+
+  void acceptor(const int &serverSocket) {
     sockaddr_in clientAddr;
     socklen_t clientLen = sizeof(clientAddr);
-    std::string sPort = std::to_string(this->opts.SERVER_PORT);
-    this->callback("Server is running on port " + sPort, false);
+    ArnelifySlabOpts slabOpts(this->opts.SERVER_SLAB_LIMIT);
+    ArnelifySlab slab(slabOpts);
 
     while (true) {
       bool isStop = !this->isRunning;
-      if (isStop) {
-        close(this->serverSocket);
-        this->callback("Server stopped.", false);
-        exit(0);
-      }
+      if (isStop) this->shutdown();
 
       const int clientSocket =
-          accept(this->serverSocket, (sockaddr *)&clientAddr, &clientLen);
+          accept(serverSocket, (sockaddr *)&clientAddr, &clientLen);
       const bool isAcceptSuccess = clientSocket != -1;
       if (!isAcceptSuccess) {
         callback("Accept failed.", true);
         exit(1);
       }
 
-      std::thread session([this, clientSocket, &clientAddr]() {
-        this->read(clientSocket, clientAddr);
+      const std::string client = this->getClient(clientAddr);
+      std::thread session([this, &slab, clientSocket, client]() {
+        this->read(&slab, clientSocket, client);
       });
 
       session.detach();
     }
   }
 
+  void onAccept(ArnelifyServerWorker &worker) {
+    sockaddr_in clientAddr;
+    socklen_t clientLen = sizeof(clientAddr);
+
+    while (true) {
+      const int clientSocket =
+          accept4(worker.serverSocket, (sockaddr *)&clientAddr, &clientLen,
+                  SOCK_NONBLOCK | SOCK_CLOEXEC);
+      const bool isAcceptSuccess = clientSocket != -1;
+      if (!isAcceptSuccess) {
+        const bool isDrained = errno == EAGAIN || errno == EWOULDBLOCK;
+        const bool isInterrupted = errno == EINTR || errno == ECONNABORTED;
+        if (isInterrupted) continue;
+        if (!isDrained) this->callback("Accept failed.", true);
+        return;
+      }
+
+      const std::string client = this->getClient(clientAddr);
+      ArnelifyServerSession *session =
+          this->createSession(worker.slab, clientSocket, client);
+      session->worker = &worker;
+      this->onWatch(worker, session);
+    }
+  }
+
+  void onClose(ArnelifyServerWorker &worker, ArnelifyServerSession *session) {
+    this->onUnwatch(worker, session);
+    close(session->socket);
+    worker.slab->release(session);
+  }
+
+  void onRead(ArnelifyServerWorker &worker, ArnelifyServerSession *session) {
+    int SIGNAL_ON_BLOCK = 0;
+    session->activity = std::chrono::steady_clock::now();
+
+    while (true) {
+      const ssize_t bytesRead = recv(session->socket, worker.block.data(),
+                                     worker.block.size(), 0);
+      if (bytesRead > 0) {
+        SIGNAL_ON_BLOCK =
+            session->receiver->onBlock(worker.block.data(), bytesRead);
+        const bool isUpload = session->receiver->isUpload();
+        if (SIGNAL_ON_BLOCK > 0 || isUpload) break;
+        continue;
+      }
+
+      const bool isInterrupted = bytesRead == -1 && errno == EINTR;
+      if (isInterrupted) continue;
+
+      const bool isDrained =
+          bytesRead == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+      if (isDrained) return;
+
+      this->onClose(worker, session);
+      return;
+    }
+
+    this->onUnwatch(worker, session);
+    session->signal = SIGNAL_ON_BLOCK;
+
+    /* Two pointers fit the small buffer of std::function, so queueing the
+       task doesn't allocate; the rest comes with the session. An upload
+       goes along with it, so files are written on the pool's threads. */
+    const bool isQueued = worker.pool->tryPush([this, session]() {
+      ArnelifyServerWorker &worker = *session->worker;
+      const int flags = fcntl(session->socket, F_GETFL, 0);
+      fcntl(session->socket, F_SETFL, flags & ~O_NONBLOCK);
+
+      const bool isUpload = session->receiver->isUpload();
+      if (isUpload) session->signal = this->upload(session);
+      const bool isKeepAlive =
+          session->signal > 0 && this->serve(session, session->signal);
+      if (!isKeepAlive) {
+        close(session->socket);
+        worker.slab->release(session);
+        return;
+      }
+
+      fcntl(session->socket, F_SETFL, flags | O_NONBLOCK);
+      session->activity = std::chrono::steady_clock::now();
+      {
+        std::lock_guard<std::mutex> lock(worker.mtx);
+        worker.returned.emplace_back(session);
+      }
+
+      const uint64_t signal = 1;
+      write(worker.eventFd, &signal, sizeof(signal));
+    });
+
+    if (!isQueued) this->reject(worker, session);
+  }
+
+  /* Answers 503 and closes when the pool's queue is full. The response
+     is sent once without waiting, as a client that doesn't read would
+     otherwise stall every other session of the worker. */
+  void reject(ArnelifyServerWorker &worker, ArnelifyServerSession *session) {
+    const std::string &response = this->unavailable;
+    send(session->socket, response.c_str(), response.length(),
+         MSG_DONTWAIT | MSG_NOSIGNAL);
+    close(session->socket);
+    worker.slab->release(session);
+  }
+
+  /* Sessions handed back by the pool after a keep-alive response are
+     re-armed on the loop thread, which owns all epoll bookkeeping. */
+  void onReturn(ArnelifyServerWorker &worker) {
+    uint64_t signal = 0;
+    while (::read(worker.eventFd, &signal, sizeof(signal)) > 0) {
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(worker.mtx);
+      worker.rearmed.swap(worker.returned);
+    }
+
+    for (ArnelifyServerSession *session : worker.rearmed) {
+      this->onWatch(worker, session);
+    }
+
+    worker.rearmed.clear();
+  }
+
+  void onTimeout(ArnelifyServerWorker &worker) {
+    const bool hasTimeout = this->opts.SERVER_KEEP_ALIVE > 0;
+    if (!hasTimeout) return;
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto timeout = std::chrono::seconds(this->opts.SERVER_KEEP_ALIVE);
+
+    /* Closing moves the last session into the closed one's place, which
+       the backward walk has already checked. */
+    for (std::size_t i = worker.sessions.size(); i > 0; --i) {
+      ArnelifyServerSession *session = worker.sessions[i - 1];
+      const bool isExpired = now - session->activity > timeout;
+      if (isExpired) this->onClose(worker, session);
+    }
+  }
+
+  /* Removes a session from the loop while the pool serves it or once it
+     is closed. The last watched session takes its place. */
+  void onUnwatch(ArnelifyServerWorker &worker,
+                 ArnelifyServerSession *session) {
+    epoll_ctl(worker.epollFd, EPOLL_CTL_DEL, session->socket, nullptr);
+    ArnelifyServerSession *last = worker.sessions.back();
+    worker.sessions[session->index] = last;
+    last->index = session->index;
+    worker.sessions.pop_back();
+  }
+
+  void onWatch(ArnelifyServerWorker &worker, ArnelifyServerSession *session) {
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLET | EPOLLRDHUP;
+    event.data.ptr = session;
+    const int socket = session->socket;
+    const bool isAddSuccess =
+        epoll_ctl(worker.epollFd, EPOLL_CTL_ADD, socket, &event) != -1;
+    if (!isAddSuccess) {
+      close(session->socket);
+      worker.slab->release(session);
+      return;
+    }
+
+    session->index = worker.sessions.size();
+    worker.sessions.emplace_back(session);
+  }
+
+  void reactor(const int &serverSocket) {
+    const int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    const int eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    const bool isEpollCreated = epollFd != -1 && eventFd != -1;
+    if (!isEpollCreated) {
+      this->callback("Epoll creation failed.", true);
+      exit(1);
+    }
+
+    const int flags = fcntl(serverSocket, F_GETFL, 0);
+    fcntl(serverSocket, F_SETFL, flags | O_NONBLOCK);
+
+    int threadLimit = this->opts.SERVER_THREAD_LIMIT;
+    if (threadLimit < 1) threadLimit = std::thread::hardware_concurrency();
+    threadLimit = std::max(1, threadLimit / this->getWorkers());
+    ArnelifyPoolOpts poolOpts(this->opts.SERVER_QUEUE_LIMIT, threadLimit);
+    ArnelifyPool pool(poolOpts);
+    ArnelifySlabOpts slabOpts(this->opts.SERVER_SLAB_LIMIT);
+    ArnelifySlab slab(slabOpts);
+
+    const std::size_t BLOCK_SIZE = this->opts.SERVER_BLOCK_SIZE_KB * 1024;
+    ArnelifyServerWorker worker(serverSocket, epollFd, eventFd, &pool, &slab,
+                                BLOCK_SIZE);
+
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLET;
+    event.data.ptr = nullptr;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, serverSocket, &event);
+
+    event.events = EPOLLIN | EPOLLET;
+    event.data.ptr = &worker;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, eventFd, &event);
+
+    std::vector<epoll_event> events(1024);
+    auto sweptAt = std::chrono::steady_clock::now();
+    while (true) {
+      bool isStop = !this->isRunning;
+      if (isStop) this->shutdown();
+
+      const int eventsLen =
+          epoll_wait(epollFd, events.data(), events.size(), 1000);
+      for (int i = 0; eventsLen > i; ++i) {
+        void *ptr = events[i].data.ptr;
+        const bool isServerSocket = ptr == nullptr;
+        if (isServerSocket) {
+          this->onAccept(worker);
+          continue;
+        }
+
+        const bool isEventFd = ptr == &worker;
+        if (isEventFd) {
+          this->onReturn(worker);
+          continue;
+        }
+
+        ArnelifyServerSession *session =
+            static_cast<ArnelifyServerSession *>(ptr);
+        this->onRead(worker, session);
+      }
+
+      const auto now = std::chrono::steady_clock::now();
+      const bool isSweep = now - sweptAt >= std::chrono::seconds(1);
+      if (isSweep) {
+        this->onTimeout(worker);
+        sweptAt = now;
+      }
+    }
+  }
+
  public:
-  ArnelifyServer(ArnelifyServerOpts &o) : isRunning(false), opts(o) {}
+  ArnelifyServer(ArnelifyServerOpts &o)
+      : isRunning(false),
+        opts(o),
+        cache(o.SERVER_GZIP_CACHE_MB * 1048576) {
+    const std::string body =
+        "{\"code\":503,\"error\":\"Service Unavailable.\"}";
+    this->unavailable =
+        "HTTP/1.1 503 Service Unavailable\r\n"
+        "Connection: close\r\n"
+        "Content-Length: " + std::to_string(body.length()) + "\r\n"
+        "Content-Type: application/json; charset=" +
+        this->opts.SERVER_CHARSET + "\r\n"
+        "Server: Arnelify Server\r\n\r\n" + body;
+  }
+
   void setHandler(const ArnelifyServerHandler &handler) {
     this->handler = handler;
   }
@@ -148,10 +595,13 @@ class ArnelifyServer {
     this->callback = callback;
     this->isRunning = true;
 
-    this->serverSocket = socket(AF_INET, SOCK_STREAM, 0);
-    const bool isServerSocketCreated = this->serverSocket != -1;
-    if (!isServerSocketCreated) {
-      this->callback("Socket creation failed.", true);
+    /* A peer that resets mid-sendfile must fail the write, not the process. */
+    signal(SIGPIPE, SIG_IGN);
+
+    const bool isIoModel = this->opts.SERVER_IO_MODEL == "thread" ||
+                           this->opts.SERVER_IO_MODEL == "epoll";
+    if (!isIoModel) {
+      this->callback("Unknown IO model: " + this->opts.SERVER_IO_MODEL, true);
       exit(1);
     }
 
@@ -159,27 +609,20 @@ class ArnelifyServer {
     this->serverAddr.sin_addr.s_addr = INADDR_ANY;
     this->serverAddr.sin_port = htons(this->opts.SERVER_PORT);
 
-    int opt = 1;
-    setsockopt(this->serverSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-    const bool isBindSuccess =
-        bind(this->serverSocket, (sockaddr *)&this->serverAddr,
-             sizeof(this->serverAddr)) != -1;
-    if (!isBindSuccess) {
-      this->callback("Bind failed.", true);
-      close(this->serverSocket);
-      exit(1);
+    const int workers = this->getWorkers();
+    for (int i = 0; workers > i; ++i) {
+      this->serverSockets.emplace_back(this->listener());
     }
 
-    const bool isListenSuccess =
-        listen(this->serverSocket, this->opts.SERVER_QUEUE_LIMIT) != -1;
-    if (!isListenSuccess) {
-      this->callback("Listen failed.", true);
-      close(this->serverSocket);
-      exit(1);
+    std::string sPort = std::to_string(this->opts.SERVER_PORT);
+    this->callback("Server is running on port " + sPort, false);
+
+    for (int i = 1; workers > i; ++i) {
+      std::thread thread([this, i]() { this->worker(i); });
+      thread.detach();
     }
 
-    this->acceptor();
-    close(this->serverSocket);
+    this->worker(0);
   }
 
   void stop() { this->isRunning = false; }
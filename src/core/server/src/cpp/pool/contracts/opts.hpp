@@ -0,0 +1,14 @@
+#ifndef ARNELIFY_POOL_OPTS_HPP
+#define ARNELIFY_POOL_OPTS_HPP
+
+#include <iostream>
+
+struct ArnelifyPoolOpts final {
+  const int POOL_QUEUE_LIMIT;
+  const int POOL_THREAD_LIMIT;
+
+  ArnelifyPoolOpts(const int &q, const int &t)
+      : POOL_QUEUE_LIMIT(q), POOL_THREAD_LIMIT(t) {};
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,8 @@
+#ifndef ARNELIFY_POOL_TASK_HPP
+#define ARNELIFY_POOL_TASK_HPP
+
+#include <functional>
+
+using ArnelifyPoolTask = std::function<void()>;
+
+#endif
\ No newline at end of file
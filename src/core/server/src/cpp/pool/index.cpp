@@ -0,0 +1,127 @@
+#ifndef ARNELIFY_POOL_CPP
+#define ARNELIFY_POOL_CPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "contracts/opts.hpp"
+#include "contracts/task.hpp"
+
+class ArnelifyPool final {
+ private:
+  bool isRunning;
+  const ArnelifyPoolOpts opts;
+  std::mutex mtx;
+  std::condition_variable isEmpty;
+  std::condition_variable isFull;
+  std::size_t head;
+  std::size_t length;
+  std::vector<ArnelifyPoolTask> tasks;
+  std::vector<std::thread> threads;
+
+  /* Tasks are queued in a ring that only grows, up to the queue limit,
+     so a busy pool doesn't allocate a deque block every few tasks. */
+  void grow() {
+    const std::size_t size = std::max<std::size_t>(16, this->tasks.size() * 2);
+    std::vector<ArnelifyPoolTask> tasks(size);
+    for (std::size_t i = 0; i < this->length; ++i) {
+      const std::size_t index = (this->head + i) % this->tasks.size();
+      tasks[i] = std::move(this->tasks[index]);
+    }
+
+    this->tasks.swap(tasks);
+    this->head = 0;
+  }
+
+  /* Appends a task to the ring. The caller holds the lock. */
+  void enqueue(ArnelifyPoolTask &&task) {
+    if (this->length == this->tasks.size()) this->grow();
+    const std::size_t index = (this->head + this->length) % this->tasks.size();
+    this->tasks[index] = std::move(task);
+    this->length += 1;
+  }
+
+  void worker() {
+    while (true) {
+      std::unique_lock<std::mutex> lock(this->mtx);
+      this->isEmpty.wait(lock, [this]() {
+        return !this->isRunning || this->length > 0;
+      });
+
+      if (!this->length) return;
+      ArnelifyPoolTask task = std::move(this->tasks[this->head]);
+      this->tasks[this->head] = nullptr;
+      this->head = (this->head + 1) % this->tasks.size();
+      this->length -= 1;
+      lock.unlock();
+
+      this->isFull.notify_one();
+      task();
+    }
+  }
+
+ public:
+  ArnelifyPool(ArnelifyPoolOpts &o)
+      : isRunning(true), opts(o), head(0), length(0) {
+    int threadLimit = this->opts.POOL_THREAD_LIMIT;
+    if (threadLimit < 1) threadLimit = std::thread::hardware_concurrency();
+    if (threadLimit < 1) threadLimit = 1;
+
+    this->threads.reserve(threadLimit);
+    for (int i = 0; threadLimit > i; ++i) {
+      this->threads.emplace_back([this]() { this->worker(); });
+    }
+  }
+
+  ~ArnelifyPool() {
+    {
+      std::lock_guard<std::mutex> lock(this->mtx);
+      this->isRunning = false;
+    }
+
+    this->isEmpty.notify_all();
+    this->isFull.notify_all();
+    for (std::thread &thread : this->threads) {
+      if (thread.joinable()) thread.join();
+    }
+  }
+
+  /* Queues a task unless the queue is full, never blocking the caller,
+     which is how the event loop hands requests over. */
+  bool tryPush(ArnelifyPoolTask &&task) {
+    std::unique_lock<std::mutex> lock(this->mtx);
+    const std::size_t queueLimit =
+        this->opts.POOL_QUEUE_LIMIT > 0 ? this->opts.POOL_QUEUE_LIMIT : 1;
+    const bool isFull = this->length >= queueLimit;
+    if (!this->isRunning || isFull) return false;
+
+    this->enqueue(std::move(task));
+    lock.unlock();
+
+    this->isEmpty.notify_one();
+    return true;
+  }
+
+  /* Blocks the caller while the queue is full, so a saturated pool
+     throttles whoever pushes instead of growing without bound. */
+  void push(ArnelifyPoolTask task) {
+    std::unique_lock<std::mutex> lock(this->mtx);
+    const std::size_t queueLimit =
+        this->opts.POOL_QUEUE_LIMIT > 0 ? this->opts.POOL_QUEUE_LIMIT : 1;
+    this->isFull.wait(lock, [this, queueLimit]() {
+      return !this->isRunning || queueLimit > this->length;
+    });
+
+    if (!this->isRunning) return;
+    this->enqueue(std::move(task));
+    lock.unlock();
+
+    this->isEmpty.notify_one();
+  }
+};
+
+#endif
\ No newline at end of file
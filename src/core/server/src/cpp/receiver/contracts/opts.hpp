@@ -13,12 +13,18 @@ struct ArnelifyReceiverOpts final {
   const int RECEIVER_MAX_FILES;
   const std::size_t RECEIVER_MAX_FILES_SIZE_TOTAL_MB;
   const std::size_t RECEIVER_MAX_FILE_SIZE_MB;
+  const std::size_t RECEIVER_UPLOAD_BUFFER_KB;
+  const bool RECEIVER_UPLOAD_DIRECT;
   const std::filesystem::path RECEIVER_UPLOAD_DIR;
+  const bool RECEIVER_UPLOAD_PREALLOCATE;
+  const bool RECEIVER_UPLOAD_DEFER;
 
   ArnelifyReceiverOpts(const bool &a, const std::string &c, const bool &k,
                        const int &mfd, const std::size_t &mfdst, const int &mfl,
                        const std::size_t &mflst, const std::size_t &mfls,
-                       const std::string &u = "./src/storage/upload")
+                       const std::string &u = "./src/storage/upload",
+                       const std::size_t &ub = 1024, const bool &ud = false,
+                       const bool &up = true, const bool &d = false)
       : RECEIVER_ALLOW_EMPTY_FILES(a),
         RECEIVER_CLIENT(c),
         RECEIVER_KEEP_EXTENSIONS(k),
@@ -27,7 +33,11 @@ struct ArnelifyReceiverOpts final {
         RECEIVER_MAX_FILES(mfl),
         RECEIVER_MAX_FILES_SIZE_TOTAL_MB(mflst),
         RECEIVER_MAX_FILE_SIZE_MB(mfls),
-        RECEIVER_UPLOAD_DIR(u) {};
+        RECEIVER_UPLOAD_BUFFER_KB(ub),
+        RECEIVER_UPLOAD_DIRECT(ud),
+        RECEIVER_UPLOAD_DIR(u),
+        RECEIVER_UPLOAD_PREALLOCATE(up),
+        RECEIVER_UPLOAD_DEFER(d) {};
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,67 @@
+#ifndef ARNELIFY_FIELDS_HPP
+#define ARNELIFY_FIELDS_HPP
+
+#include <functional>
+#include <iostream>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+/* Distinct field names of a form. A form of a few fields is scanned in a
+   small vector; past SPILL names they move into a hash set, so a form of
+   N fields costs O(N) instead of O(N^2) comparisons. Both keep their
+   capacity across requests. */
+class ArnelifyFields final {
+ private:
+  struct Hash {
+    using is_transparent = void;
+    std::size_t operator()(const std::string_view &name) const {
+      return std::hash<std::string_view>{}(name);
+    }
+  };
+
+  static constexpr std::size_t SPILL = 16;
+
+  bool isHashed;
+  std::unordered_set<std::string, Hash, std::equal_to<>> hashed;
+  std::vector<std::string> names;
+  std::size_t length;
+
+ public:
+  ArnelifyFields() : isHashed(false), length(0) {}
+
+  void clear() {
+    this->isHashed = false;
+    this->hashed.clear();
+    this->length = 0;
+  }
+
+  /* Registers "name" and returns false if it was already there. */
+  bool insert(const std::string_view &name) {
+    if (this->isHashed) return this->hashed.emplace(name).second;
+
+    for (std::size_t i = 0; i < this->length; ++i) {
+      if (this->names[i] == name) return false;
+    }
+
+    const bool isSpill = this->length == SPILL;
+    if (isSpill) {
+      for (std::size_t i = 0; i < this->length; ++i) {
+        this->hashed.emplace(std::move(this->names[i]));
+      }
+
+      this->isHashed = true;
+      return this->hashed.emplace(name).second;
+    }
+
+    if (this->length == this->names.size()) this->names.emplace_back();
+    this->names[this->length++].assign(name);
+    return true;
+  }
+
+  std::size_t size() const {
+    return this->isHashed ? this->hashed.size() : this->length;
+  }
+};
+
+#endif
\ No newline at end of file
@@ -1,17 +1,23 @@
 #ifndef ARNELIFY_RECEIVER_HPP
 #define ARNELIFY_RECEIVER_HPP
 
+#include <algorithm>
+#include <charconv>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <random>
+#include <string_view>
 #include <vector>
 
 #include "json.h"
 
 #include "contracts/opts.hpp"
-
-using ArnelifyServerReq = Json::Value;
+#include "fields/index.cpp"
+#include "matcher/index.cpp"
+#include "request/index.cpp"
+#include "scanner/index.cpp"
+#include "sink/index.cpp"
 
 class ArnelifyReceiver final {
  private:
@@ -28,20 +34,30 @@ class ArnelifyReceiver final {
   bool startSize;
   const ArnelifyReceiverOpts opts;
   std::string buffer;
+  std::size_t headersStart;
+  std::size_t offset;
+  std::size_t scanned;
+  std::string leftover;
   ArnelifyServerReq req;
+  ArnelifyServerReq finished;
 
   std::string acceptEncoding;
+  std::string connection;
   std::string contentType;
   std::string boundary;
-  std::vector<std::string> prefixes;
+  ArnelifyMatcher matcher;
   std::string status;
 
+  bool isEpilogue;
+  bool isPart;
+  bool isPreamble;
+
   std::size_t length;
   std::string mime;
   std::string name;
   int size;
 
-  std::vector<std::string> fields;
+  ArnelifyFields fields;
   std::size_t fieldsSizeTotal;
   std::string body;
 
@@ -52,134 +68,58 @@ class ArnelifyReceiver final {
   std::string fileReal;
   std::size_t fileSize;
   bool isWrite;
+  ArnelifySink* sink;
 
-  void addKey(const std::string& name) {
-    const std::size_t patternStart = name.find("[");
-    const bool isPattern = patternStart != std::string::npos;
-    if (isPattern) {
-      const std::string key = name.substr(0, patternStart);
-      const bool hasKey = std::find(this->fields.begin(), this->fields.end(),
-                                    key) != fields.end();
-      if (!hasKey) this->fields.emplace_back(key);
-      return;
-    }
-
-    const bool hasKey = std::find(this->fields.begin(), this->fields.end(),
-                                  name) != fields.end();
-    if (!hasKey) this->fields.emplace_back(name);
+  /* Fields are counted by the name before the first "[", so "tags[]"
+     and "tags[0][]" are one field. */
+  void addKey(const std::string_view& name) {
+    this->fields.insert(name.substr(0, name.find('[')));
   }
 
-  const std::string decode(const std::string& encoded) {
-    std::string decoded;
-    int hex;
-
-    for (size_t i = 0; i < encoded.length(); ++i) {
-      const bool isHex = encoded[i] == '%';
-      if (isHex) {
-        if (i + 2 < encoded.length() &&
-            sscanf(encoded.substr(i + 1, 2).c_str(), "%x", &hex) == 1) {
-          decoded += static_cast<char>(hex);
-          i += 2;
-        }
-
-        continue;
-      }
-
-      const bool isSpace = encoded[i] == '+';
-      if (isSpace) {
-        decoded += ' ';
-        continue;
-      }
-
-      decoded += encoded[i];
-    }
-
-    return decoded;
+  void setBody() {
+    ArnelifyServerReq::append(this->req.body, this->name, this->body);
   }
 
-  const std::vector<std::string> getKeys(const std::string& name) {
-    const std::size_t patternStart = name.find("[]");
-    const bool hasPattern = patternStart != std::string::npos;
-    if (!hasPattern) return {name};
-
-    std::vector<std::string> keys;
-    std::string buffer = name.substr(0, patternStart);
+  int setBoundary(const std::string_view& value) {
+    const std::size_t boundaryStart = value.find("boundary=");
+    const bool hasBoundary = boundaryStart != std::string_view::npos;
+    if (!hasBoundary) return this->SIGNAL_FINISH;
 
-    std::size_t keyStart = buffer.find("[");
-    const bool hasKeyStart = keyStart != std::string::npos;
-    if (!hasKeyStart) return {buffer};
-
-    keys.emplace_back(buffer.substr(0, keyStart));
-    buffer = buffer.substr(keyStart);
-    keyStart = buffer.find("[");
-
-    while (keyStart != std::string::npos) {
-      const std::size_t keyEnd = buffer.find("]", keyStart + 1);
-      const bool hasKeyEnd = keyEnd != std::string::npos;
-      if (!hasKeyEnd) return {name};
-
-      const std::string key =
-          buffer.substr(keyStart + 1, keyEnd - keyStart - 1);
-      const std::size_t innerStart = key.find("[");
-      const bool hasInner = innerStart != std::string::npos;
-      if (hasInner) return {name};
-
-      keys.emplace_back(key);
-      keyStart = buffer.find("[", keyEnd + 1);
-    }
+    std::string_view boundary = value.substr(boundaryStart + 9);
+    boundary = boundary.substr(0, boundary.find(';'));
+    const bool isQuoted = boundary.length() >= 2 && boundary.front() == '"' &&
+                          boundary.back() == '"';
+    if (isQuoted) boundary = boundary.substr(1, boundary.length() - 2);
 
-    return keys;
-  }
+    this->boundary = "--";
+    this->boundary.append(boundary);
 
-  void setBody() {
-    Json::Value* current = &req["body"];
-    const std::vector<std::string> keys = getKeys(this->name);
-    for (const auto& key : keys) {
-      if (current->isArray()) return;
-      current = &(*current)[key];
-    }
+    /* Every boundary but the first follows a CRLF ending the previous part,
+       so the matcher starts as if that CRLF had already been seen. */
+    this->matcher.setPattern("\r\n" + this->boundary, 2);
+    this->isPart = true;
+    this->isPreamble = true;
 
-    const bool isArray = (*current).isArray();
-    if (!isArray) (*current) = Json::arrayValue;
-    (*current).append(this->body);
+    return this->SIGNAL_FINISH;
   }
 
-  int setBoundary(const std::string& value) {
-    const int boundaryStart = value.find("boundary=");
-    const bool hasBoundary = boundaryStart != std::string::npos;
-    if (!hasBoundary) return this->SIGNAL_ACCEPTED;
-
-    this->boundary = "--" + value.substr(boundaryStart + 9);
+  int setCookie(const std::string_view& value) {
+    std::size_t paramStart = 0;
+    while (paramStart < value.length()) {
+      std::size_t paramEnd = value.find(';', paramStart);
+      if (paramEnd == std::string_view::npos) paramEnd = value.length();
 
-    for (std::size_t i = 1; this->boundary.length() >= i; ++i) {
-      const std::string prefix = this->boundary.substr(0, i);
-      const bool isPrefix = this->boundary != prefix;
-      if (isPrefix) this->prefixes.emplace_back(prefix);
-    }
+      std::string_view param = value.substr(paramStart, paramEnd - paramStart);
+      paramStart = paramEnd + 1;
+      while (!param.empty() && param.front() == ' ') param.remove_prefix(1);
 
-    return this->SIGNAL_FINISH;
-  }
-
-  int setCookie(const std::string& value) {
-    bool isFirst = true;
-    std::stringstream ss(value);
-    std::string param;
-    while (std::getline(ss, param, ';')) {
       const std::size_t equalStart = param.find('=');
-      const bool hasEqual = equalStart != std::string::npos;
-      if (hasEqual) {
-        if (isFirst) {
-          const std::string name = param.substr(0, equalStart);
-          const std::string data = param.substr(equalStart + 1);
-          this->req["_state"]["cookie"][name] = data;
-          isFirst = false;
-          continue;
-        }
+      const bool hasEqual = equalStart != std::string_view::npos;
+      if (!hasEqual) continue;
 
-        const std::string name = param.substr(1, equalStart - 1);
-        const std::string data = param.substr(equalStart + 1);
-        this->req["_state"]["cookie"][name] = data;
-      }
+      const std::string_view name = param.substr(0, equalStart);
+      const std::string_view data = param.substr(equalStart + 1);
+      this->req.cookies.push_back({this->toSpan(name), this->toSpan(data)});
     }
 
     return this->SIGNAL_FINISH;
@@ -194,17 +134,7 @@ class ArnelifyReceiver final {
     file["real"] = this->fileReal;
     file["size"] = Json::UInt64(this->fileSize);
     this->isWrite = false;
-
-    Json::Value* current = &this->req["files"];
-    std::vector<std::string> keys = this->getKeys(this->name);
-    for (const auto& key : keys) {
-      if (current->isArray()) return;
-      current = &(*current)[key];
-    }
-
-    const bool isArray = (*current).isArray();
-    if (!isArray) (*current) = Json::arrayValue;
-    (*current).append(file);
+    ArnelifyServerReq::append(this->req.files, this->name, std::move(file));
   }
 
   int setFilename(const std::string& value) {
@@ -249,25 +179,69 @@ class ArnelifyReceiver final {
     return this->SIGNAL_FINISH;
   }
 
-  int setHeader(const std::string& key, const std::string& value) {
-    this->req["_state"]["headers"][key] = value;
+  int setSink() {
+    if (!this->sink) {
+      ArnelifySinkOpts opts(this->opts.RECEIVER_UPLOAD_BUFFER_KB,
+                            this->opts.RECEIVER_UPLOAD_DIRECT,
+                            this->opts.RECEIVER_UPLOAD_PREALLOCATE);
+      this->sink = new ArnelifySink(opts);
+    }
+
+    const std::size_t maxFileSize =
+        this->opts.RECEIVER_MAX_FILE_SIZE_MB * 1024 * 1024;
+    const std::size_t expected = std::min(this->length - this->size,
+                                          maxFileSize);
+    const bool isOpen = this->sink->open(this->filePath, expected);
+    if (!isOpen) {
+      this->status = "Can't save file.";
+      return this->SIGNAL_ERROR;
+    }
+
+    return this->SIGNAL_FINISH;
+  }
+
+  /* Disk write figures of the uploaded files, for the request stats. */
+  void setStats() {
+    if (!this->sink || !this->sink->getBytes()) return;
+
+    const double seconds = this->sink->getSeconds();
+    const double bytes = static_cast<double>(this->sink->getBytes());
+    Json::Value upload = Json::objectValue;
+    upload["bytes"] = Json::UInt64(this->sink->getBytes());
+    upload["ms"] = seconds * 1000;
+    upload["mbps"] = seconds > 0 ? bytes / seconds / 1048576 : 0;
+    this->req.upload = upload;
+    this->sink->resetStats();
+  }
+
+  int setHeader(const std::string_view& key, const std::string_view& value) {
+    this->req.headers.push_back({this->toSpan(key), this->toSpan(value)});
+
+    const bool isConnection = key == "Connection";
+    if (isConnection) {
+      this->connection.clear();
+      for (char c : value) this->connection += std::tolower(c);
+      return this->SIGNAL_FINISH;
+    }
 
     const bool isAcceptEncoding = key == "Accept-Encoding";
     if (isAcceptEncoding) {
-      this->acceptEncoding = value;
+      /* Repeated lines are one list, as if they were comma-separated. */
+      if (!this->acceptEncoding.empty()) this->acceptEncoding += ", ";
+      this->acceptEncoding += value;
       return this->SIGNAL_FINISH;
     }
 
     const bool isContentLength = key == "Content-Length";
     if (isContentLength) {
-      for (char c : value) {
-        if (!isdigit(c)) {
-          this->status = "Content-Length must be a number.";
-          return this->SIGNAL_ERROR;
-        }
+      const char* end = value.data() + value.length();
+      const auto [ptr, ec] = std::from_chars(value.data(), end, this->length);
+      const bool isNumber = !value.empty() && ec == std::errc() && ptr == end;
+      if (!isNumber) {
+        this->status = "Content-Length must be a number.";
+        return this->SIGNAL_ERROR;
       }
 
-      this->length = std::stoull(value);
       return this->SIGNAL_FINISH;
     }
 
@@ -278,64 +252,55 @@ class ArnelifyReceiver final {
         return this->SIGNAL_FINISH;
       }
 
-      const std::size_t semicolonStart = value.find(";");
-      const bool hasSemicolon = semicolonStart != std::string::npos;
+      const std::size_t semicolonStart = value.find(';');
+      const bool hasSemicolon = semicolonStart != std::string_view::npos;
       if (!hasSemicolon) {
         this->contentType = value;
         return this->SIGNAL_FINISH;
       }
 
       this->contentType = value.substr(0, semicolonStart);
-      const int SIGNAL_BOUNDARY = this->setBoundary(value);
-      if (SIGNAL_BOUNDARY != this->SIGNAL_FINISH) return SIGNAL_BOUNDARY;
+      return this->setBoundary(value);
     }
 
     const bool isCookie = key == "Cookie";
-    if (isCookie) {
-      const int SIGNAL_COOKIE = this->setCookie(value);
-      if (SIGNAL_COOKIE != this->SIGNAL_FINISH) return SIGNAL_COOKIE;
-    }
+    if (isCookie) return this->setCookie(value);
 
     return this->SIGNAL_FINISH;
   }
 
-  int setQuery(const std::string& param, const std::string query) {
-    std::stringstream ss(query);
-    std::string pair;
-
-    while (std::getline(ss, pair, '&')) {
-      const std::size_t equalStart = pair.find("=");
-      const bool hasEqual = equalStart != std::string::npos;
-
-      const std::string name = pair.substr(0, equalStart);
-      const std::string value = pair.substr(equalStart + 1);
-
-      bool isValidKey = true;
-      Json::Value* current = &req[param];
-      const std::vector<std::string> keys = this->getKeys(name);
-      for (const auto& key : keys) {
-        if (current->isArray()) {
-          isValidKey = false;
-          break;
-        }
-
-        current = &(*current)[key];
-      }
-
-      if (!isValidKey) continue;
-      const bool isArray = (*current).isArray();
-      if (!isArray) (*current) = Json::arrayValue;
-      (*current).append(value);
-    }
+  /* Offset of a view of the head, which stays valid while the buffer
+     grows and once the head is copied into the request. */
+  ArnelifyServerReq::Span toSpan(const std::string_view& view) {
+    const std::size_t start = view.data() - this->buffer.data();
+    return {start, view.length()};
+  }
 
-    return this->SIGNAL_FINISH;
+  /* The request line and headers are scanned in place: "offset" is the
+     start of the token being parsed and "scanned" is how far the buffer
+     has already been searched for its delimiter, so every byte of the
+     head is inspected once no matter how it was split into blocks. */
+  std::size_t scan(const std::string_view& delimiter) {
+    const std::size_t from = std::max(this->offset, this->scanned);
+    const std::size_t end =
+        ArnelifyScanner::find(this->buffer, delimiter, from);
+    const bool hasEnd = end != std::string::npos;
+    if (hasEnd) {
+      this->scanned = end + delimiter.length();
+      return end;
+    }
+
+    const std::size_t tail = delimiter.length() - 1;
+    const std::size_t length = this->buffer.length();
+    this->scanned = length > tail ? length - tail : 0;
+    return std::string::npos;
   }
 
   int onMethod() {
-    const std::size_t methodEnd = this->buffer.find(' ');
+    const std::size_t methodEnd = this->scan(" ");
     const bool hasMethod = methodEnd != std::string::npos;
     if (!hasMethod) {
-      const int isMaxMethodSize = this->buffer.length() > 8;
+      const bool isMaxMethodSize = this->buffer.length() - this->offset > 8;
       if (isMaxMethodSize) {
         this->status = "The maximum size of the method has been exceeded.";
         return this->SIGNAL_ERROR;
@@ -344,13 +309,13 @@ class ArnelifyReceiver final {
       return this->SIGNAL_ACCEPTED;
     }
 
-    const int isMaxMethodSize = methodEnd - 1 > 8;
+    const std::string_view method(this->buffer.data(), methodEnd);
+    const bool isMaxMethodSize = method.length() > 8;
     if (isMaxMethodSize) {
       this->status = "The maximum size of the method has been exceeded.";
       return this->SIGNAL_ERROR;
     }
 
-    const std::string method = this->buffer.substr(0, methodEnd);
     const bool isSupport =
         method == "GET" || method == "POST" || method == "PUT" ||
         method == "DELETE" || method == "HEAD" || method == "OPTIONS" ||
@@ -362,18 +327,18 @@ class ArnelifyReceiver final {
 
     this->hasBody = !(method == "PATCH" || method == "POST" ||
                       method == "PUT" || method == "DELETE");
-    this->req["_state"]["method"] = method;
-    this->buffer = this->buffer.substr(methodEnd + 1);
+    this->req.method = this->toSpan(method);
+    this->offset = methodEnd + 1;
     this->hasMethod = true;
 
     return this->SIGNAL_FINISH;
   }
 
   int onPath() {
-    const std::size_t urlEnd = this->buffer.find(' ');
+    const std::size_t urlEnd = this->scan(" ");
     const bool hasUrl = urlEnd != std::string::npos;
     if (!hasUrl) {
-      const int isMaxUrlSize = this->buffer.length() > 2048;
+      const bool isMaxUrlSize = this->buffer.length() - this->offset > 2048;
       if (isMaxUrlSize) {
         this->status = "The maximum size of the URL has been exceeded.";
         return this->SIGNAL_ERROR;
@@ -382,35 +347,34 @@ class ArnelifyReceiver final {
       return this->SIGNAL_ACCEPTED;
     }
 
-    const int isMaxUrlSize = urlEnd - 1 > 2048;
+    const std::string_view url(this->buffer.data() + this->offset,
+                               urlEnd - this->offset);
+    const bool isMaxUrlSize = url.length() > 2048;
     if (isMaxUrlSize) {
       this->status = "The maximum size of the URL has been exceeded.";
       return this->SIGNAL_ERROR;
     }
 
-    const std::string url = this->buffer.substr(0, urlEnd);
     const std::size_t queryStart = url.find('?');
-    const bool hasQuery = queryStart != std::string::npos;
+    const bool hasQuery = queryStart != std::string_view::npos;
+    const std::string_view path = url.substr(0, queryStart);
+    this->req.path = this->toSpan(path);
     if (hasQuery) {
-      this->req["_state"]["path"] = url.substr(0, queryStart);
-      const std::string encoded = url.substr(queryStart + 1);
-      const std::string decoded = this->decode(encoded);
-      this->setQuery("query", decoded);
-    } else {
-      this->req["_state"]["path"] = url;
+      ArnelifyServerReq::setFields(url.substr(queryStart + 1),
+                                   this->req.params, this->req.query);
     }
 
-    this->buffer = this->buffer.substr(urlEnd + 1);
+    this->offset = urlEnd + 1;
     this->hasPath = true;
 
     return this->SIGNAL_FINISH;
   }
 
   int onVersion() {
-    const std::size_t versionEnd = this->buffer.find("\r\n");
+    const std::size_t versionEnd = this->scan("\r\n");
     const bool hasVersion = versionEnd != std::string::npos;
     if (!hasVersion) {
-      const int isMaxVersionSize = this->buffer.length() > 10;
+      const bool isMaxVersionSize = this->buffer.length() - this->offset > 10;
       if (isMaxVersionSize) {
         this->status = "The maximum size of the version has been exceeded.";
         return this->SIGNAL_ERROR;
@@ -419,56 +383,62 @@ class ArnelifyReceiver final {
       return this->SIGNAL_ACCEPTED;
     }
 
-    const int isMaxVersionSize = versionEnd - 1 > 10;
+    const std::string_view version(this->buffer.data() + this->offset,
+                                   versionEnd - this->offset);
+    const bool isMaxVersionSize = version.length() > 10;
     if (isMaxVersionSize) {
       this->status = "The maximum size of the version has been exceeded.";
       return this->SIGNAL_ERROR;
     }
 
-    this->req["_state"]["version"] = this->buffer.substr(0, versionEnd);
-    this->buffer = this->buffer.substr(versionEnd + 2);
+    this->req.version = this->toSpan(version);
+    this->offset = versionEnd + 2;
+    this->headersStart = this->offset;
     this->hasVersion = true;
     return this->SIGNAL_FINISH;
   }
 
   int onHeaders() {
-    const std::size_t headersEnd = this->buffer.find("\r\n\r\n");
-    const bool hasHeaders = headersEnd != std::string::npos;
-    if (!hasHeaders) {
-      const int isMaxHeadersSize = this->buffer.length() > 8192;
+    while (true) {
+      const std::size_t headerEnd = this->scan("\r\n");
+      const bool hasHeader = headerEnd != std::string::npos;
+      if (!hasHeader) {
+        const bool isMaxHeadersSize =
+            this->buffer.length() - this->headersStart > 8192;
+        if (isMaxHeadersSize) {
+          this->status = "The maximum size of headers has been exceeded.";
+          return this->SIGNAL_ERROR;
+        }
+
+        return this->SIGNAL_ACCEPTED;
+      }
+
+      const bool isMaxHeadersSize = headerEnd - this->headersStart > 8192;
       if (isMaxHeadersSize) {
         this->status = "The maximum size of headers has been exceeded.";
         return this->SIGNAL_ERROR;
       }
 
-      return this->SIGNAL_ACCEPTED;
-    }
-
-    const int isMaxHeadersSize = headersEnd - 1 > 8192;
-    if (isMaxHeadersSize) {
-      this->status = "The maximum size of headers has been exceeded.";
-      return this->SIGNAL_ERROR;
-    }
+      const std::string_view header(this->buffer.data() + this->offset,
+                                    headerEnd - this->offset);
+      this->offset = headerEnd + 2;
+      const bool isHeadersEnd = header.empty();
+      if (isHeadersEnd) break;
 
-    std::string headers = this->buffer.substr(0, headersEnd + 2);
-    std::size_t headerEnd = headers.find("\r\n");
-    while (headerEnd != std::string::npos) {
-      const std::string header = headers.substr(0, headerEnd);
       const std::size_t colonStart = header.find(": ");
-
-      const bool hasColon = colonStart != std::string::npos;
+      const bool hasColon = colonStart != std::string_view::npos;
       if (hasColon) {
-        const std::string key = header.substr(0, colonStart);
-        const std::string value = header.substr(colonStart + 2);
+        const std::string_view key = header.substr(0, colonStart);
+        const std::string_view value = header.substr(colonStart + 2);
         const int SIGNAL_HEADER = this->setHeader(key, value);
         if (SIGNAL_HEADER != this->SIGNAL_FINISH) return SIGNAL_HEADER;
       }
-
-      headers = headers.substr(headerEnd + 2);
-      headerEnd = headers.find("\r\n");
     }
 
-    this->buffer = this->buffer.substr(headersEnd + 4);
+    this->req.head.assign(this->buffer, 0, this->offset);
+    this->buffer.erase(0, this->offset);
+    this->offset = 0;
+    this->scanned = 0;
     this->size = this->buffer.length();
     this->hasHeaders = true;
 
@@ -548,6 +518,9 @@ class ArnelifyReceiver final {
             const int SIGNAL_FILE = this->setFilename(filename);
             if (SIGNAL_FILE != this->SIGNAL_FINISH) return SIGNAL_FILE;
 
+            const int SIGNAL_SINK = this->setSink();
+            if (SIGNAL_SINK != this->SIGNAL_FINISH) return SIGNAL_SINK;
+
             this->isWrite = true;
           }
         }
@@ -576,16 +549,8 @@ class ArnelifyReceiver final {
   int onJson() {
     const bool bodyEnd = this->size == this->length;
     if (bodyEnd) {
-      Json::Value body;
-      Json::CharReaderBuilder reader;
-      std::string errors;
-
-      std::istringstream iss(this->buffer);
-      if (!Json::parseFromStream(reader, iss, &this->req["body"], &errors)) {
-        this->status = "The body contains invalid JSON.";
-        return this->SIGNAL_ERROR;
-      }
-
+      this->req.raw.swap(this->buffer);
+      this->req.isJson = true;
       this->hasBody = true;
       return this->SIGNAL_FINISH;
     }
@@ -594,97 +559,93 @@ class ArnelifyReceiver final {
   }
 
   int onMultipart() {
-    for (const auto& prefix : this->prefixes) {
-      const bool hasPrefix = this->buffer.ends_with(prefix);
-      if (hasPrefix) return this->SIGNAL_ACCEPTED;
-    }
-
-    std::size_t boundaryStart = this->buffer.find(this->boundary);
-    while (boundaryStart != std::string::npos) {
-      const std::string before = this->buffer.substr(0, boundaryStart);
-      const bool hasBefore = before.length() >= 2;
-      if (hasBefore) {
-        const std::size_t beforeLen = before.length() - 2;
-        if (this->isWrite) {
-          const bool isAllowEmptyFiles =
-              !this->opts.RECEIVER_ALLOW_EMPTY_FILES && !beforeLen;
-          if (isAllowEmptyFiles) {
-            this->status = "Empty files are not allowed.";
-            return this->SIGNAL_ERROR;
-          }
-
-          this->fileSize += beforeLen;
-          this->filesSizeTotal += beforeLen;
+    while (true) {
+      if (this->isEpilogue) {
+        this->buffer.clear();
+        const bool bodyEnd = this->size == this->length;
+        if (!bodyEnd) return this->SIGNAL_ACCEPTED;
 
-          const bool isMaxFileSize =
-              this->fileSize >
-              this->opts.RECEIVER_MAX_FILE_SIZE_MB * 1024 * 1024;
-          if (isMaxFileSize) {
-            this->status = "The maximum size of the file has been exceeded.";
-            return this->SIGNAL_ERROR;
-          }
-
-          const bool isMaxFilesSizeTotal =
-              this->filesSizeTotal >
-              this->opts.RECEIVER_MAX_FILES_SIZE_TOTAL_MB * 1024 * 1024;
-          if (isMaxFilesSizeTotal) {
-            this->status = "The maximum size of files has been exceeded.";
-            return this->SIGNAL_ERROR;
-          }
+        this->setStats();
+        this->hasBody = true;
+        return this->SIGNAL_FINISH;
+      }
 
-          const int SIGNAL_ON_WRITE =
-              this->onWrite(before.substr(0, beforeLen));
-          if (SIGNAL_ON_WRITE != this->SIGNAL_FINISH) return SIGNAL_ON_WRITE;
-          this->setFile();
+      if (this->isPart) {
+        const std::size_t pending = this->matcher.getMatched();
+        const std::size_t partEnd =
+            this->matcher.onBlock(this->buffer.data(), this->buffer.length());
+        const bool hasPartEnd = partEnd != ArnelifyMatcher::npos;
+        if (!hasPartEnd) {
+          const std::size_t partLen =
+              pending + this->buffer.length() - this->matcher.getMatched();
+          const int SIGNAL_ON_PART = this->onPart(pending, partLen);
+          if (SIGNAL_ON_PART != this->SIGNAL_FINISH) return SIGNAL_ON_PART;
+
+          this->buffer.clear();
+          return this->SIGNAL_ACCEPTED;
+        }
 
-        } else {
-          this->fieldsSizeTotal += beforeLen;
+        const std::string& delimiter = this->matcher.getPattern();
+        const std::size_t partLen = pending + partEnd - delimiter.length();
+        const int SIGNAL_ON_PART = this->onPart(pending, partLen);
+        if (SIGNAL_ON_PART != this->SIGNAL_FINISH) return SIGNAL_ON_PART;
 
-          const bool isMaxFieldsSizeTotal =
-              this->fieldsSizeTotal >
-              this->opts.RECEIVER_MAX_FIELDS_SIZE_TOTAL_MB * 1024 * 1024;
-          if (isMaxFieldsSizeTotal) {
-            this->status = "The maximum size of fields has been exceeded.";
-            return this->SIGNAL_ERROR;
-          }
+        const int SIGNAL_PART_END = this->onPartEnd();
+        if (SIGNAL_PART_END != this->SIGNAL_FINISH) return SIGNAL_PART_END;
 
-          this->body.append(before.substr(0, beforeLen));
-          this->setBody();
-        }
-
-        this->buffer = this->buffer.substr(boundaryStart);
-        boundaryStart = this->buffer.find(this->boundary);
+        this->buffer.erase(0, partEnd);
+        this->isPart = false;
       }
 
-      const std::string bodyEnd = this->boundary + "--\r\n";
-      const bool hasBodyEnd = this->buffer.starts_with(bodyEnd);
-      if (hasBodyEnd) {
-        this->hasBody = true;
-        return this->SIGNAL_FINISH;
-      }
+      const bool hasDashes = this->buffer.length() >= 2;
+      if (!hasDashes) return this->SIGNAL_ACCEPTED;
 
-      const std::size_t boundaryEnd = this->buffer.find("\r\n", boundaryStart);
-      const bool hasBoundaryEnd = boundaryEnd != std::string::npos;
-      if (!hasBoundaryEnd) return this->SIGNAL_ACCEPTED;
+      const bool isLast = this->buffer.starts_with("--");
+      if (isLast) {
+        this->isEpilogue = true;
+        continue;
+      }
 
+      const std::size_t boundaryEnd =
+          ArnelifyScanner::find(this->buffer, "\r\n");
       const std::size_t metaEnd =
-          this->buffer.find("\r\n\r\n", boundaryEnd + 2);
-      const bool hasMetas = metaEnd != std::string::npos;
-      if (!hasMetas) return this->SIGNAL_ACCEPTED;
+          ArnelifyScanner::find(this->buffer, "\r\n\r\n", boundaryEnd);
+      const bool hasMetas = boundaryEnd != std::string::npos &&
+                            metaEnd != std::string::npos;
+      if (!hasMetas) {
+        const bool isMaxMetaSize = this->buffer.length() > 8192;
+        if (isMaxMetaSize) {
+          this->status = "The maximum size of part headers has been exceeded.";
+          return this->SIGNAL_ERROR;
+        }
+
+        return this->SIGNAL_ACCEPTED;
+      }
 
       std::string meta =
           this->buffer.substr(boundaryEnd + 2, metaEnd - boundaryEnd);
       const int SIGNAL_ON_META = this->onMeta(meta);
       if (SIGNAL_ON_META != this->SIGNAL_FINISH) return SIGNAL_ON_META;
 
-      this->buffer = this->buffer.substr(metaEnd + 4);
-      boundaryStart = this->buffer.find(this->boundary);
+      this->buffer.erase(0, metaEnd + 4);
+      this->matcher.reset();
+      this->isPart = true;
     }
+  }
+
+  /* Hands "partLen" bytes of the part over to its file or field: first the
+     "pending" delimiter bytes held by the matcher, then the buffer. */
+  int onPart(const std::size_t& pending, const std::size_t& partLen) {
+    if (this->isPreamble || !partLen) return this->SIGNAL_FINISH;
+
+    const std::string& delimiter = this->matcher.getPattern();
+    const std::size_t heldLen = std::min(pending, partLen);
+    const std::string_view held(delimiter.data(), heldLen);
+    const std::string_view block(this->buffer.data(), partLen - heldLen);
 
     if (this->isWrite) {
-      if (this->buffer.empty()) return this->SIGNAL_ACCEPTED;
-      this->filesSizeTotal += this->buffer.length();
-      this->fileSize += this->buffer.length();
+      this->fileSize += partLen;
+      this->filesSizeTotal += partLen;
 
       const bool isMaxFileSize =
           this->fileSize > this->opts.RECEIVER_MAX_FILE_SIZE_MB * 1024 * 1024;
@@ -701,14 +662,16 @@ class ArnelifyReceiver final {
         return this->SIGNAL_ERROR;
       }
 
-      const int SIGNAL_ON_WRITE = this->onWrite(this->buffer);
-      if (SIGNAL_ON_WRITE != SIGNAL_FINISH) return SIGNAL_ON_WRITE;
-      this->buffer.clear();
+      if (!held.empty()) {
+        const int SIGNAL_ON_WRITE = this->onWrite(held);
+        if (SIGNAL_ON_WRITE != this->SIGNAL_FINISH) return SIGNAL_ON_WRITE;
+      }
 
-      return this->SIGNAL_ACCEPTED;
+      if (block.empty()) return this->SIGNAL_FINISH;
+      return this->onWrite(block);
     }
 
-    this->fieldsSizeTotal += this->buffer.length();
+    this->fieldsSizeTotal += partLen;
 
     const bool isMaxFieldsSizeTotal =
         this->fieldsSizeTotal >
@@ -718,36 +681,57 @@ class ArnelifyReceiver final {
       return this->SIGNAL_ERROR;
     }
 
-    this->body.append(this->buffer);
-    this->buffer.clear();
+    this->body.append(held);
+    this->body.append(block);
+    return this->SIGNAL_FINISH;
+  }
 
-    return this->SIGNAL_ACCEPTED;
+  int onPartEnd() {
+    if (this->isPreamble) {
+      this->isPreamble = false;
+      return this->SIGNAL_FINISH;
+    }
+
+    if (this->isWrite) {
+      const bool isAllowEmptyFiles =
+          !this->opts.RECEIVER_ALLOW_EMPTY_FILES && !this->fileSize;
+      if (isAllowEmptyFiles) {
+        this->status = "Empty files are not allowed.";
+        return this->SIGNAL_ERROR;
+      }
+
+      const bool isClosed = this->sink->close();
+      if (!isClosed) {
+        this->status = "Can't save file.";
+        return this->SIGNAL_ERROR;
+      }
+
+      this->setFile();
+      return this->SIGNAL_FINISH;
+    }
+
+    this->setBody();
+    return this->SIGNAL_FINISH;
   }
 
   int onUrlEncoded() {
     const bool bodyEnd = this->size == this->length;
     if (bodyEnd) {
-      const std::string decoded = this->decode(this->buffer);
-      this->setQuery("body", decoded);
+      this->req.raw.swap(this->buffer);
       this->hasBody = true;
-
       return this->SIGNAL_FINISH;
     }
 
     return this->SIGNAL_ACCEPTED;
   }
 
-  int onWrite(const std::string& block) {
-    std::ofstream file(this->filePath, std::ios::app);
-    const bool isOpen = file.is_open();
-    if (!isOpen) {
+  int onWrite(const std::string_view& block) {
+    const bool isWritten = this->sink->write(block);
+    if (!isWritten) {
       this->status = "Can't save file.";
       return this->SIGNAL_ERROR;
     }
 
-    file << block;
-    file.close();
-
     return this->SIGNAL_FINISH;
   }
 
@@ -757,9 +741,6 @@ class ArnelifyReceiver final {
         SIGNAL_ERROR(1),
         SIGNAL_FINISH(2),
 
-        opts(o),
-        length(0),
-
         hasBody(false),
         hasHeaders(false),
         hasMethod(false),
@@ -767,26 +748,34 @@ class ArnelifyReceiver final {
         hasVersion(false),
 
         startSize(false),
-        size(0),
+        opts(o),
+        headersStart(0),
+        offset(0),
+        scanned(0),
 
+        isEpilogue(false),
+        isPart(false),
+        isPreamble(false),
+
+        length(0),
+        size(0),
         fieldsSizeTotal(0),
+
         filesCounter(0),
         filesSizeTotal(0),
-        isWrite(false) {
+        isWrite(false),
+        sink(nullptr) {
     this->status = "Invalid request.";
-    this->req["body"] = Json::objectValue;
-    this->req["files"] = Json::objectValue;
-    this->req["query"] = Json::objectValue;
-
-    Json::Value _state;
-    _state["client"] = this->opts.RECEIVER_CLIENT;
-    _state["cookie"] = Json::objectValue;
-    _state["headers"] = Json::objectValue;
-    this->req["_state"] = _state;
+    this->req.client = this->opts.RECEIVER_CLIENT;
+    this->finished.client = this->opts.RECEIVER_CLIENT;
+  }
+
+  ~ArnelifyReceiver() {
+    if (this->sink) delete this->sink;
   }
 
   int onBlock(const char* block, const std::size_t& bytesRead) {
-    this->buffer.append(block, bytesRead);
+    if (bytesRead) this->buffer.append(block, bytesRead);
 
     if (!this->hasMethod) {
       const int SIGNAL_ON_METHOD = this->onMethod();
@@ -806,15 +795,26 @@ class ArnelifyReceiver final {
     if (!this->hasHeaders) {
       const int SIGNAL_ON_HEADERS = this->onHeaders();
       if (SIGNAL_ON_HEADERS != this->SIGNAL_FINISH) return SIGNAL_ON_HEADERS;
+
+      /* With RECEIVER_UPLOAD_DEFER, a multipart body is left for the next
+         call, so the reader can move the upload off its thread before any
+         file is written. */
+      if (this->isUpload()) {
+        this->startSize = true;
+        return this->SIGNAL_ACCEPTED;
+      }
     }
 
     if (!this->hasBody) {
       if (this->startSize) this->size += bytesRead;
       if (!this->startSize) this->startSize = true;
-      const bool isError = this->size > this->length;
-      if (isError) {
-        this->status = "The body exceeds the Content-Length.";
-        return this->SIGNAL_ERROR;
+      const bool hasExcess = this->size > this->length;
+      if (hasExcess) {
+        const std::size_t excess = this->size - this->length;
+        const std::size_t bodyLen = this->buffer.length() - excess;
+        this->leftover.append(this->buffer, bodyLen);
+        this->buffer.resize(bodyLen);
+        this->size = this->length;
       }
 
       const bool isJson = this->contentType == "application/json";
@@ -826,18 +826,75 @@ class ArnelifyReceiver final {
 
       const bool isMultipart =
           this->contentType == "multipart/form-data" && !this->boundary.empty();
-      if (isMultipart) return this->onMultipart();
+      if (isMultipart) {
+        const int SIGNAL_ON_MULTIPART = this->onMultipart();
+        const bool isIncomplete =
+            SIGNAL_ON_MULTIPART == this->SIGNAL_ACCEPTED &&
+            this->size == this->length;
+        if (isIncomplete) {
+          this->status = "The body is shorter than the Content-Length.";
+          return this->SIGNAL_ERROR;
+        }
+
+        return SIGNAL_ON_MULTIPART;
+      }
+
       return this->onUrlEncoded();
     }
 
+    this->leftover.append(this->buffer);
+    this->buffer.clear();
     return this->SIGNAL_FINISH;
   }
 
-  const std::string getEncoding() { return this->acceptEncoding; }
+  const std::string& getEncoding() { return this->acceptEncoding; }
+
+  /* Bytes of the next pipelined request received along with this one. */
+  bool hasPending() { return !this->buffer.empty(); }
+
+  /* True from the end of the headers of a multipart request until its
+     body is complete, when uploads are deferred. */
+  bool isUpload() {
+    return this->opts.RECEIVER_UPLOAD_DEFER && this->hasHeaders &&
+           !this->hasBody &&
+           this->contentType == "multipart/form-data" &&
+           !this->boundary.empty();
+  }
+
+  bool isKeepAlive() {
+    const std::string_view version = this->req.getVersion();
+    if (this->connection.find("close") != std::string::npos) return false;
+    if (version == "HTTP/1.1") return true;
+    return this->connection.find("keep-alive") != std::string::npos;
+  }
 
   const std::string getStatus() { return this->status; }
 
-  const Json::Value finish() {
+  /* Readies a receiver kept from a closed connection for the next one,
+     dropping whatever the peer left unfinished. Buffers are kept unless
+     an upload or a large body grew them past 64 KB. */
+  void recycle() {
+    this->leftover.clear();
+    this->finish();
+    this->buffer.clear();
+    this->finished.clear();
+    for (std::string *buffer : {&this->body, &this->buffer, &this->leftover,
+                                &this->req.raw, &this->finished.raw}) {
+      if (buffer->capacity() > 65536) std::string().swap(*buffer);
+    }
+  }
+
+  void setClient(const std::string& client) {
+    this->req.client = client;
+    this->finished.client = client;
+  }
+
+  /* Hands over the parsed request. It stays valid until the next call,
+     while the receiver goes on with the next request in the other one. */
+  const ArnelifyServerReq& finish() {
+    std::swap(this->req, this->finished);
+    this->req.clear();
+
     this->hasBody = false;
     this->hasHeaders = false;
     this->hasMethod = false;
@@ -846,11 +903,18 @@ class ArnelifyReceiver final {
     this->startSize = false;
 
     this->buffer.clear();
+    this->buffer.swap(this->leftover);
+    this->headersStart = 0;
+    this->offset = 0;
+    this->scanned = 0;
 
     this->acceptEncoding.clear();
+    this->connection.clear();
     this->contentType.clear();
     this->boundary.clear();
-    this->prefixes.clear();
+    this->isEpilogue = false;
+    this->isPart = false;
+    this->isPreamble = false;
     this->status.clear();
 
     this->length = 0;
@@ -870,7 +934,13 @@ class ArnelifyReceiver final {
     this->fileSize = 0;
 
     this->isWrite = false;
-    return this->req;
+    if (this->sink) {
+      this->sink->close();
+      this->sink->resetStats();
+    }
+
+    this->status = "Invalid request.";
+    return this->finished;
   }
 };
 
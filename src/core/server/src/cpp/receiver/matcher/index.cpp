@@ -0,0 +1,83 @@
+#ifndef ARNELIFY_MATCHER_HPP
+#define ARNELIFY_MATCHER_HPP
+
+#include <algorithm>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+#include "../scanner/index.cpp"
+
+/* Streaming delimiter matcher. A delimiter split across blocks is tracked
+   as the number of its leading bytes already seen, so the caller never has
+   to hold bytes back: they are a prefix of the delimiter by definition.
+   Whole blocks are searched with ArnelifyScanner, only the bytes around a
+   block edge are stepped through the KMP failure table. */
+class ArnelifyMatcher final {
+ private:
+  std::vector<std::size_t> failure;
+  std::size_t matched;
+  std::string pattern;
+
+  std::size_t step(std::size_t state, const char& c) {
+    while (state && c != this->pattern[state]) state = this->failure[state - 1];
+    if (c == this->pattern[state]) ++state;
+    return state;
+  }
+
+ public:
+  static constexpr std::size_t npos = std::string_view::npos;
+
+  ArnelifyMatcher() : matched(0) {}
+
+  const std::string& getPattern() { return this->pattern; }
+
+  /* Number of delimiter bytes seen at the end of the last block. */
+  std::size_t getMatched() { return this->matched; }
+
+  /* Returns the offset just past the delimiter in this block, or npos. */
+  std::size_t onBlock(const char* data, const std::size_t& length) {
+    std::size_t i = 0;
+    while (this->matched && i < length) {
+      this->matched = this->step(this->matched, data[i++]);
+      const bool isMatch = this->matched == this->pattern.length();
+      if (isMatch) {
+        this->matched = 0;
+        return i;
+      }
+    }
+
+    const std::string_view block(data + i, length - i);
+    const std::size_t index = ArnelifyScanner::find(block, this->pattern);
+    const bool hasPattern = index != npos;
+    if (hasPattern) return i + index + this->pattern.length();
+
+    const std::size_t tail =
+        std::min(length - i, this->pattern.length() - 1);
+    for (std::size_t j = length - tail; j < length; ++j) {
+      this->matched = this->step(this->matched, data[j]);
+    }
+
+    return npos;
+  }
+
+  void reset(const std::size_t& matched = 0) { this->matched = matched; }
+
+  void setPattern(const std::string_view& pattern,
+                  const std::size_t& matched = 0) {
+    this->pattern = pattern;
+    this->failure.assign(pattern.length(), 0);
+    for (std::size_t i = 1, state = 0; i < pattern.length(); ++i) {
+      while (state && pattern[i] != pattern[state]) {
+        state = this->failure[state - 1];
+      }
+
+      if (pattern[i] == pattern[state]) ++state;
+      this->failure[i] = state;
+    }
+
+    this->matched = matched;
+  }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,405 @@
+#ifndef ARNELIFY_REQUEST_HPP
+#define ARNELIFY_REQUEST_HPP
+
+#include <array>
+#include <cctype>
+#include <iostream>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "json.h"
+
+/* Request handed to the handler. The head is kept as it was received and
+   method, path, headers and cookies are spans of it; query parameters are
+   spans of their decoded copy. A receiver keeps its requests for the whole
+   connection, so once these buffers have grown, a request without a body
+   is parsed without allocating. A JSON or urlencoded body is kept as it
+   was received and only parsed once the handler asks for it, so requests
+   that are turned away never pay for it. The Json::Value tree handlers
+   used to get is likewise only built when one is asked for. */
+class ArnelifyServerReq final {
+ private:
+  friend class ArnelifyReceiver;
+
+  struct Span {
+    std::size_t start;
+    std::size_t length;
+  };
+
+  struct Field {
+    Span key;
+    Span value;
+  };
+
+  std::string client;
+  std::string head;
+  std::string params;
+  std::string raw;
+
+  Span method;
+  Span path;
+  Span version;
+  std::vector<Field> cookies;
+  std::vector<Field> headers;
+  std::vector<Field> query;
+
+  bool isJson;
+  mutable bool isParsed;
+  mutable bool isValid;
+  mutable Json::Value body;
+  Json::Value files;
+  Json::Value upload;
+
+  mutable bool hasJson;
+  mutable bool isRawJson;
+  mutable Json::Value json;
+
+  /* Value of each hex digit, -1 for any other byte. */
+  static constexpr std::array<signed char, 256> HEX = [] {
+    std::array<signed char, 256> table{};
+    table.fill(-1);
+    for (int i = 0; i < 10; ++i) table['0' + i] = i;
+    for (int i = 0; i < 6; ++i) {
+      table['a' + i] = 10 + i;
+      table['A' + i] = 10 + i;
+    }
+
+    return table;
+  }();
+
+  /* Appends "encoded" to "decoded" with "+" as a space and "%XX" as the
+     byte it stands for. A "%" without two hex digits after it is dropped.
+     The output is never longer than the input, so it is sized once. */
+  static void decode(const std::string_view &encoded, std::string &decoded) {
+    const std::size_t decodedStart = decoded.length();
+    decoded.resize(decodedStart + encoded.length());
+    char *out = decoded.data() + decodedStart;
+    const char *it = encoded.data();
+    const char *end = it + encoded.length();
+
+    while (it < end) {
+      const char c = *it++;
+      if (c == '+') {
+        *out++ = ' ';
+        continue;
+      }
+
+      if (c != '%') {
+        *out++ = c;
+        continue;
+      }
+
+      const bool hasDigits = end - it >= 2;
+      if (!hasDigits) continue;
+
+      const int high = HEX[static_cast<unsigned char>(it[0])];
+      const int low = HEX[static_cast<unsigned char>(it[1])];
+      if (high < 0 || low < 0) continue;
+
+      *out++ = static_cast<char>(high << 4 | low);
+      it += 2;
+    }
+
+    decoded.resize(out - decoded.data());
+  }
+
+  /* Splits an urlencoded string into pairs on "&" and "=" before decoding
+     their names and values into "decoded", so an escaped "&" or "=" stays
+     in its name or value. A pair without "=" is both the name and the
+     value. */
+  static void setFields(const std::string_view &encoded, std::string &decoded,
+                        std::vector<Field> &fields) {
+    decoded.reserve(decoded.length() + encoded.length());
+    std::size_t pairStart = 0;
+    while (pairStart < encoded.length()) {
+      std::size_t pairEnd = encoded.find('&', pairStart);
+      if (pairEnd == std::string_view::npos) pairEnd = encoded.length();
+
+      const std::string_view pair =
+          encoded.substr(pairStart, pairEnd - pairStart);
+      const std::size_t equalStart = pair.find('=');
+      const std::size_t keyStart = decoded.length();
+      decode(pair.substr(0, equalStart), decoded);
+      const Span key{keyStart, decoded.length() - keyStart};
+      pairStart = pairEnd + 1;
+
+      const bool hasEqual = equalStart != std::string_view::npos;
+      if (!hasEqual) {
+        fields.push_back({key, key});
+        continue;
+      }
+
+      const std::size_t valueStart = decoded.length();
+      decode(pair.substr(equalStart + 1), decoded);
+      fields.push_back({key, {valueStart, decoded.length() - valueStart}});
+    }
+  }
+
+  /* Splits a field name such as "user[tags][]" into its keys, which are
+     views of it. A name without "[]" or with malformed brackets is a key
+     of its own. */
+  static void getKeys(const std::string_view &name,
+                      std::vector<std::string_view> &keys) {
+    keys.clear();
+    const std::size_t patternStart = name.find("[]");
+    const bool hasPattern = patternStart != std::string_view::npos;
+    if (!hasPattern) {
+      keys.push_back(name);
+      return;
+    }
+
+    const std::string_view buffer = name.substr(0, patternStart);
+    std::size_t keyStart = buffer.find('[');
+    const bool hasKeyStart = keyStart != std::string_view::npos;
+    if (!hasKeyStart) {
+      keys.push_back(buffer);
+      return;
+    }
+
+    keys.push_back(buffer.substr(0, keyStart));
+    while (keyStart != std::string_view::npos) {
+      const std::size_t keyEnd = buffer.find(']', keyStart + 1);
+      const bool hasKeyEnd = keyEnd != std::string_view::npos;
+      const std::string_view key =
+          buffer.substr(keyStart + 1, keyEnd - keyStart - 1);
+      const bool hasInner = key.find('[') != std::string_view::npos;
+      if (!hasKeyEnd || hasInner) {
+        keys.assign(1, name);
+        return;
+      }
+
+      keys.push_back(key);
+      keyStart = buffer.find('[', keyEnd + 1);
+    }
+  }
+
+  /* Appends "value" to the array the keys of "name" lead to in "root".
+     A name that runs into an array on its way is dropped. */
+  static void append(Json::Value &root, const std::string_view &name,
+                     Json::Value &&value) {
+    thread_local std::vector<std::string_view> keys;
+    getKeys(name, keys);
+
+    Json::Value *current = &root;
+    for (const std::string_view &key : keys) {
+      if (current->isArray()) return;
+      current = current->demand(key.data(), key.data() + key.length());
+    }
+
+    const bool isArray = current->isArray();
+    if (!isArray) *current = Json::arrayValue;
+    current->append(std::move(value));
+  }
+
+  static bool isSame(const std::string_view &a, const std::string_view &b) {
+    if (a.length() != b.length()) return false;
+    for (std::size_t i = 0; i < a.length(); ++i) {
+      const unsigned char left = a[i];
+      const unsigned char right = b[i];
+      if (std::tolower(left) != std::tolower(right)) return false;
+    }
+
+    return true;
+  }
+
+  /* The last field named "key", as repeated headers and cookies used to
+     overwrite each other. */
+  std::string_view find(const std::vector<Field> &fields,
+                        const std::string &buffer, const std::string_view &key,
+                        const bool &isCaseless) const {
+    for (auto it = fields.rbegin(); it != fields.rend(); ++it) {
+      const std::string_view name = this->view(buffer, it->key);
+      const bool isMatch = isCaseless ? isSame(name, key) : name == key;
+      if (isMatch) return this->view(buffer, it->value);
+    }
+
+    return {};
+  }
+
+  /* Parses the raw body on the first call. A multipart body was already
+     parsed while it was received and leaves "raw" empty. */
+  void parse() const {
+    if (this->isParsed) return;
+    this->isParsed = true;
+
+    if (this->isJson) {
+      thread_local const std::unique_ptr<Json::CharReader> reader(
+          Json::CharReaderBuilder().newCharReader());
+      const char *start = this->raw.data();
+      std::string errors;
+      this->isValid = reader->parse(start, start + this->raw.length(),
+                                    &this->body, &errors);
+      if (!this->isValid) this->body = Json::Value();
+      return;
+    }
+
+    if (this->raw.empty()) return;
+
+    std::string decoded;
+    std::vector<Field> fields;
+    setFields(this->raw, decoded, fields);
+    for (const Field &field : fields) {
+      append(this->body, this->view(decoded, field.key),
+             this->toValue(decoded, field.value));
+    }
+  }
+
+  std::string_view view(const std::string &buffer, const Span &span) const {
+    return std::string_view(buffer.data() + span.start, span.length);
+  }
+
+  Json::Value toValue(const std::string &buffer, const Span &span) const {
+    const char *start = buffer.data() + span.start;
+    return Json::Value(start, start + span.length);
+  }
+
+  /* Forgets the request but keeps the capacity of its buffers. */
+  void clear() {
+    this->head.clear();
+    this->params.clear();
+    this->method = {0, 0};
+    this->path = {0, 0};
+    this->version = {0, 0};
+    this->cookies.clear();
+    this->headers.clear();
+    this->query.clear();
+    this->raw.clear();
+    this->isJson = false;
+    this->isParsed = false;
+    this->isValid = true;
+    this->body = Json::Value();
+    this->files = Json::Value();
+    this->upload = Json::Value();
+    this->hasJson = false;
+    this->isRawJson = false;
+    this->json = Json::Value();
+  }
+
+ public:
+  ArnelifyServerReq()
+      : method{0, 0},
+        path{0, 0},
+        version{0, 0},
+        isJson(false),
+        isParsed(false),
+        isValid(true),
+        hasJson(false),
+        isRawJson(false) {}
+
+  /* Parsed body of a JSON, urlencoded or multipart request; null when the
+     request had none or its JSON is invalid. */
+  const Json::Value &getBody() const {
+    this->parse();
+    return this->body;
+  }
+
+  std::string_view getClient() const { return this->client; }
+
+  std::string_view getCookie(const std::string_view &key) const {
+    return this->find(this->cookies, this->head, key, false);
+  }
+
+  /* Uploaded files of a multipart request; null when there were none. */
+  const Json::Value &getFiles() const { return this->files; }
+
+  /* Header names are matched regardless of case. */
+  std::string_view getHeader(const std::string_view &key) const {
+    return this->find(this->headers, this->head, key, true);
+  }
+
+  std::string_view getMethod() const {
+    return this->view(this->head, this->method);
+  }
+
+  std::string_view getPath() const {
+    return this->view(this->head, this->path);
+  }
+
+  /* The first value of a query parameter, looked up by its full name. */
+  std::string_view getQuery(const std::string_view &key) const {
+    for (const Field &field : this->query) {
+      if (this->view(this->params, field.key) != key) continue;
+      return this->view(this->params, field.value);
+    }
+
+    return {};
+  }
+
+  /* The JSON or urlencoded body as it was received, without parsing it. */
+  std::string_view getRawBody() const { return this->raw; }
+
+  std::string_view getVersion() const {
+    return this->view(this->head, this->version);
+  }
+
+  /* False once a JSON body failed to parse, which parses it if needed. */
+  bool isValidBody() const {
+    this->parse();
+    return this->isValid;
+  }
+
+  /* The request as the Json::Value tree of "_state", "body", "files" and
+     "query", built on the first call. With "isRaw" a JSON or urlencoded
+     body is the string it was received as and is never parsed. */
+  const Json::Value &toJson(const bool &isRaw = false) const {
+    if (this->hasJson && this->isRawJson == isRaw) return this->json;
+
+    Json::Value &json = this->json;
+    json = Json::objectValue;
+    Json::Value &state = json["_state"];
+    state["client"] = this->client;
+    Json::Value &cookie = state["cookie"];
+    cookie = Json::objectValue;
+    for (const Field &field : this->cookies) {
+      const std::string_view key = this->view(this->head, field.key);
+      *cookie.demand(key.data(), key.data() + key.length()) =
+          this->toValue(this->head, field.value);
+    }
+
+    Json::Value &headers = state["headers"];
+    headers = Json::objectValue;
+    for (const Field &field : this->headers) {
+      const std::string_view key = this->view(this->head, field.key);
+      *headers.demand(key.data(), key.data() + key.length()) =
+          this->toValue(this->head, field.value);
+    }
+
+    state["method"] = this->toValue(this->head, this->method);
+    state["path"] = this->toValue(this->head, this->path);
+    if (!this->upload.isNull()) state["upload"] = this->upload;
+    state["version"] = this->toValue(this->head, this->version);
+
+    const bool isRawBody = isRaw && (this->isJson || !this->raw.empty());
+    if (isRawBody) {
+      json["body"] = this->raw;
+    } else {
+      const Json::Value &body = this->getBody();
+      json["body"] = body.isNull() ? Json::objectValue : body;
+    }
+
+    json["files"] = this->files.isNull() ? Json::objectValue : this->files;
+    Json::Value &query = json["query"];
+    query = Json::objectValue;
+    for (const Field &field : this->query) {
+      append(query, this->view(this->params, field.key),
+             this->toValue(this->params, field.value));
+    }
+
+    this->hasJson = true;
+    this->isRawJson = isRaw;
+    return json;
+  }
+
+  operator const Json::Value &() const { return this->toJson(); }
+
+  const Json::Value &operator[](const char *key) const {
+    return this->toJson()[key];
+  }
+
+  const Json::Value &operator[](const std::string &key) const {
+    return this->toJson()[key];
+  }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,155 @@
+#ifndef ARNELIFY_SCANNER_HPP
+#define ARNELIFY_SCANNER_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ARNELIFY_SCANNER_X86
+#endif
+
+/* Delimiter search for the receiver. Terminators up to CRLFCRLF are
+   found with memchr, which libc already vectorizes and which nothing here
+   beats when the first byte is rare. Longer needles are multipart
+   delimiters: on CPUs with AVX2, a vector of the haystack is compared
+   with their first byte, then the same positions with their last byte,
+   and only positions matching both are verified with memcmp. */
+class ArnelifyScanner final {
+ private:
+  using Kernel = std::size_t (*)(const char*, const std::size_t, const char*,
+                                 const std::size_t);
+
+  static Kernel getKernel() {
+#ifdef ARNELIFY_SCANNER_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return findAvx2;
+#endif
+    return findScalar;
+  }
+
+  static bool isMatch(const char* candidate, const char* needle,
+                      const std::size_t& needleLen) {
+    if (needleLen <= 2) return true;
+    return !std::memcmp(candidate + 1, needle + 1, needleLen - 2);
+  }
+
+  static std::size_t onMask(const char* haystack, std::uint64_t mask,
+                            const char* needle, const std::size_t& needleLen) {
+    while (mask) {
+      const std::size_t bit = __builtin_ctzll(mask);
+      if (isMatch(haystack + bit, needle, needleLen)) return bit;
+      mask &= mask - 1;
+    }
+
+    return npos;
+  }
+
+  /* Inputs shorter than one unrolled step, and the rest of longer ones,
+     are handed to memchr. */
+  static std::size_t onTail(const char* haystack, const std::size_t& i,
+                            const std::size_t& haystackLen, const char* needle,
+                            const std::size_t& needleLen) {
+    const std::size_t index =
+        findScalar(haystack + i, haystackLen - i, needle, needleLen);
+    if (index == npos) return npos;
+    return i + index;
+  }
+
+#ifdef ARNELIFY_SCANNER_X86
+  __attribute__((target("avx2"))) static __m256i loadAvx2(const char* data) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+  }
+
+  __attribute__((target("avx2"))) static std::uint64_t maskAvx2(
+      const __m256i& eq, const __m256i& last, const char* tail) {
+    const __m256i both =
+        _mm256_and_si256(eq, _mm256_cmpeq_epi8(last, loadAvx2(tail)));
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(both));
+  }
+#endif
+
+ public:
+  static constexpr std::size_t npos = std::string_view::npos;
+
+  static std::size_t find(const std::string_view& haystack,
+                          const std::string_view& needle,
+                          const std::size_t& from = 0) {
+    static const Kernel kernel = getKernel();
+    if (from > haystack.length()) return npos;
+    if (needle.empty()) return from;
+
+    const bool isTerminator = needle.length() <= 4;
+    const Kernel search = isTerminator ? findScalar : kernel;
+    const std::size_t index =
+        search(haystack.data() + from, haystack.length() - from,
+               needle.data(), needle.length());
+    if (index == npos) return npos;
+    return from + index;
+  }
+
+  static std::size_t findScalar(const char* haystack,
+                                const std::size_t haystackLen,
+                                const char* needle,
+                                const std::size_t needleLen) {
+    if (needleLen > haystackLen) return npos;
+
+    const char* cursor = haystack;
+    const char* last = haystack + haystackLen - needleLen;
+    while (cursor <= last) {
+      const void* first = std::memchr(cursor, needle[0], last - cursor + 1);
+      if (!first) return npos;
+
+      cursor = static_cast<const char*>(first);
+      const bool isCandidate = cursor[needleLen - 1] == needle[needleLen - 1];
+      if (isCandidate && isMatch(cursor, needle, needleLen)) {
+        return cursor - haystack;
+      }
+
+      ++cursor;
+    }
+
+    return npos;
+  }
+
+#ifdef ARNELIFY_SCANNER_X86
+  __attribute__((target("avx2"))) static std::size_t findAvx2(
+      const char* haystack, const std::size_t haystackLen, const char* needle,
+      const std::size_t needleLen) {
+    if (needleLen > haystackLen) return npos;
+
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needleLen - 1]);
+    const std::size_t candidates = haystackLen - needleLen + 1;
+
+    std::size_t i = 0;
+    for (; i + 128 <= candidates; i += 128) {
+      const char* block = haystack + i;
+      const __m256i a = _mm256_cmpeq_epi8(first, loadAvx2(block));
+      const __m256i b = _mm256_cmpeq_epi8(first, loadAvx2(block + 32));
+      const __m256i c = _mm256_cmpeq_epi8(first, loadAvx2(block + 64));
+      const __m256i d = _mm256_cmpeq_epi8(first, loadAvx2(block + 96));
+      const __m256i any =
+          _mm256_or_si256(_mm256_or_si256(a, b), _mm256_or_si256(c, d));
+      if (_mm256_testz_si256(any, any)) continue;
+
+      const char* tail = block + needleLen - 1;
+      const std::uint64_t low =
+          maskAvx2(a, last, tail) | maskAvx2(b, last, tail + 32) << 32;
+      const std::size_t lowIndex = onMask(block, low, needle, needleLen);
+      if (lowIndex != npos) return i + lowIndex;
+
+      const std::uint64_t high =
+          maskAvx2(c, last, tail + 64) | maskAvx2(d, last, tail + 96) << 32;
+      const std::size_t highIndex = onMask(block + 64, high, needle, needleLen);
+      if (highIndex != npos) return i + 64 + highIndex;
+    }
+
+    return onTail(haystack, i, haystackLen, needle, needleLen);
+  }
+#endif
+};
+
+#endif
\ No newline at end of file
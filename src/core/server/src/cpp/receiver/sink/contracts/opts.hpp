@@ -0,0 +1,15 @@
+#ifndef ARNELIFY_SINK_OPTS_HPP
+#define ARNELIFY_SINK_OPTS_HPP
+
+#include <iostream>
+
+struct ArnelifySinkOpts final {
+  const std::size_t SINK_BUFFER_KB;
+  const bool SINK_DIRECT;
+  const bool SINK_PREALLOCATE;
+
+  ArnelifySinkOpts(const std::size_t &b, const bool &d, const bool &p)
+      : SINK_BUFFER_KB(b), SINK_DIRECT(d), SINK_PREALLOCATE(p) {};
+};
+
+#endif
\ No newline at end of file
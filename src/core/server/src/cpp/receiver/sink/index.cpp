@@ -0,0 +1,190 @@
+#ifndef ARNELIFY_SINK_CPP
+#define ARNELIFY_SINK_CPP
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <string_view>
+#include <unistd.h>
+
+#include "contracts/opts.hpp"
+
+/* Upload file writer. One descriptor stays open for the whole part, small
+   blocks are coalesced into an aligned buffer before they reach the disk,
+   and the time spent in write(2) is tracked for the request stats. */
+class ArnelifySink final {
+ private:
+  /* Blocks of this size already make write(2) worth its cost, copying
+     them into the buffer would only spend memory bandwidth. */
+  static constexpr std::size_t UNIT = 65536;
+
+  const ArnelifySinkOpts opts;
+  char* buffer;
+  std::size_t bufferLen;
+  std::size_t capacity;
+  int fd;
+  bool isDirect;
+  bool isPreallocated;
+  std::size_t written;
+
+  std::size_t bytes;
+  std::chrono::steady_clock::duration elapsed;
+
+  bool onWrite(const char* data, std::size_t length) {
+    const auto start = std::chrono::steady_clock::now();
+    while (length) {
+      const ssize_t count = ::write(this->fd, data, length);
+      if (count < 0) {
+        if (errno == EINTR) continue;
+        return false;
+      }
+
+      data += count;
+      length -= count;
+    }
+
+    this->elapsed += std::chrono::steady_clock::now() - start;
+    return true;
+  }
+
+  bool onFlush() {
+    if (!this->bufferLen) return true;
+
+    /* O_DIRECT only takes whole aligned blocks, the tail of the file is
+       written through the page cache. */
+    const bool isTail = this->isDirect && this->bufferLen % 4096;
+    if (isTail) {
+      const int flags = fcntl(this->fd, F_GETFL);
+      fcntl(this->fd, F_SETFL, flags & ~O_DIRECT);
+      this->isDirect = false;
+    }
+
+    const bool isWritten = this->onWrite(this->buffer, this->bufferLen);
+    this->bufferLen = 0;
+    return isWritten;
+  }
+
+ public:
+  ArnelifySink(ArnelifySinkOpts& o)
+      : opts(o),
+        buffer(nullptr),
+        bufferLen(0),
+        capacity(0),
+        fd(-1),
+        isDirect(false),
+        isPreallocated(false),
+        written(0),
+        bytes(0),
+        elapsed(0) {}
+
+  ~ArnelifySink() {
+    this->close();
+    std::free(this->buffer);
+  }
+
+  bool close() {
+    if (this->fd == -1) return true;
+
+    bool isClosed = this->onFlush();
+    if (this->isPreallocated) {
+      isClosed = ftruncate(this->fd, this->written) == 0 && isClosed;
+    }
+
+    isClosed = ::close(this->fd) == 0 && isClosed;
+    this->fd = -1;
+    this->isDirect = false;
+    this->isPreallocated = false;
+    return isClosed;
+  }
+
+  std::size_t getBytes() { return this->bytes; }
+
+  double getSeconds() {
+    return std::chrono::duration<double>(this->elapsed).count();
+  }
+
+  /* Opens a new part. "expected" is an upper bound of its size, when it
+     is known the blocks are reserved up front. */
+  bool open(const std::filesystem::path& path, const std::size_t& expected) {
+    this->close();
+
+    /* Most requests carry no files, the buffer is allocated on first use. */
+    std::size_t capacity = this->opts.SINK_BUFFER_KB * 1024;
+    if (this->opts.SINK_DIRECT && !capacity) capacity = 1024 * 1024;
+    const bool isAllocate = capacity && !this->buffer;
+    if (isAllocate) {
+      this->capacity = (capacity + 4095) / 4096 * 4096;
+      void* buffer = std::aligned_alloc(4096, this->capacity);
+      this->buffer = static_cast<char*>(buffer);
+      if (!this->buffer) this->capacity = 0;
+    }
+
+    const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    const bool isDirect = this->opts.SINK_DIRECT && this->capacity;
+    if (isDirect) {
+      this->fd = ::open(path.c_str(), flags | O_DIRECT, 0644);
+      this->isDirect = this->fd != -1;
+    }
+
+    if (this->fd == -1) this->fd = ::open(path.c_str(), flags, 0644);
+    if (this->fd == -1) return false;
+
+    const bool isPreallocate = this->opts.SINK_PREALLOCATE && expected;
+    if (isPreallocate) {
+      this->isPreallocated =
+          fallocate(this->fd, FALLOC_FL_KEEP_SIZE, 0, expected) == 0;
+    }
+
+    this->written = 0;
+    return true;
+  }
+
+  void resetStats() {
+    this->bytes = 0;
+    this->elapsed = std::chrono::steady_clock::duration(0);
+  }
+
+  bool write(const std::string_view& block) {
+    this->bytes += block.length();
+    this->written += block.length();
+    if (!this->capacity) return this->onWrite(block.data(), block.length());
+
+    const bool isLarge = !this->isDirect &&
+                         block.length() >= std::min(this->capacity, UNIT);
+    if (isLarge) {
+      return this->onFlush() && this->onWrite(block.data(), block.length());
+    }
+
+    /* O_DIRECT takes a page-aligned block as it is, only its unaligned
+       tail goes through the buffer. */
+    std::size_t offset = 0;
+    const bool isAligned =
+        this->isDirect && !this->bufferLen &&
+        reinterpret_cast<std::uintptr_t>(block.data()) % 4096 == 0;
+    if (isAligned) {
+      offset = block.length() / 4096 * 4096;
+      if (offset && !this->onWrite(block.data(), offset)) return false;
+    }
+
+    while (offset < block.length()) {
+      const std::size_t chunk = std::min(this->capacity - this->bufferLen,
+                                         block.length() - offset);
+      std::memcpy(this->buffer + this->bufferLen, block.data() + offset, chunk);
+      this->bufferLen += chunk;
+      offset += chunk;
+
+      const bool isFull = this->bufferLen == this->capacity;
+      if (isFull && !this->onFlush()) return false;
+    }
+
+    return true;
+  }
+};
+
+#endif
\ No newline at end of file
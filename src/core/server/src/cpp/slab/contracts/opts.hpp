@@ -0,0 +1,12 @@
+#ifndef ARNELIFY_SLAB_OPTS_HPP
+#define ARNELIFY_SLAB_OPTS_HPP
+
+#include <iostream>
+
+struct ArnelifySlabOpts final {
+  const int SLAB_LIMIT;
+
+  ArnelifySlabOpts(const int &l) : SLAB_LIMIT(l) {};
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,57 @@
+#ifndef ARNELIFY_SLAB_CPP
+#define ARNELIFY_SLAB_CPP
+
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include "../contracts/session.hpp"
+#include "contracts/opts.hpp"
+
+/* Sessions of closed connections, kept for the next ones a worker
+   accepts. A recycled session comes with the receiver, transmitter and
+   read block the previous connection has grown, so once a worker has
+   served as many connections at a time as it is going to, neither a new
+   connection nor its requests allocate. Up to SLAB_LIMIT sessions are
+   kept; the ones beyond are freed. */
+class ArnelifySlab final {
+ private:
+  const ArnelifySlabOpts opts;
+  std::mutex mtx;
+  std::vector<ArnelifyServerSession *> sessions;
+
+ public:
+  ArnelifySlab(ArnelifySlabOpts &o) : opts(o) {}
+
+  ~ArnelifySlab() {
+    for (ArnelifyServerSession *session : this->sessions) delete session;
+  }
+
+  /* Returns a kept session, or nullptr when there is none. */
+  ArnelifyServerSession *acquire() {
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (this->sessions.empty()) return nullptr;
+
+    ArnelifyServerSession *session = this->sessions.back();
+    this->sessions.pop_back();
+    return session;
+  }
+
+  /* Takes the session of a closed connection. */
+  void release(ArnelifyServerSession *session) {
+    session->recycle();
+    {
+      std::lock_guard<std::mutex> lock(this->mtx);
+      const bool isFull =
+          static_cast<int>(this->sessions.size()) >= this->opts.SLAB_LIMIT;
+      if (!isFull) {
+        this->sessions.emplace_back(session);
+        return;
+      }
+    }
+
+    delete session;
+  }
+};
+
+#endif
\ No newline at end of file
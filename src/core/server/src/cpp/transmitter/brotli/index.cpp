@@ -0,0 +1,88 @@
+#ifndef ARNELIFY_BROTLI_HPP
+#define ARNELIFY_BROTLI_HPP
+
+/* Defined by the Makefile when pkg-config finds libbrotlienc, which also
+   links it. */
+#ifdef ARNELIFY_HAS_BROTLI
+
+#include <algorithm>
+#include <brotli/encode.h>
+#include <iostream>
+#include <vector>
+
+#include "../contracts/output.hpp"
+
+/* Brotli stream of a worker. An encoder can't be reset, so every response
+   gets a new one; only the output block is kept between responses. */
+class ArnelifyBrotli final {
+ private:
+  std::vector<char> buffer;
+  std::size_t availOut;
+  uint8_t *nextOut;
+  BrotliEncoderState *state;
+
+  ArnelifyBrotli() : availOut(0), nextOut(nullptr), state(nullptr) {}
+
+ public:
+  using Output = ArnelifyTransmitterOutput;
+
+  ArnelifyBrotli(const ArnelifyBrotli &) = delete;
+  ArnelifyBrotli &operator=(const ArnelifyBrotli &) = delete;
+
+  ~ArnelifyBrotli() {
+    if (this->state) BrotliEncoderDestroyInstance(this->state);
+  }
+
+  static ArnelifyBrotli &get() {
+    thread_local ArnelifyBrotli brotli;
+    return brotli;
+  }
+
+  /* Starts a new stream with output blocks of "blockSize" bytes. */
+  bool begin(int level, const std::size_t &blockSize) {
+    if (this->state) BrotliEncoderDestroyInstance(this->state);
+    this->state = BrotliEncoderCreateInstance(nullptr, nullptr, nullptr);
+    if (!this->state) return false;
+
+    level = std::clamp(level, BROTLI_MIN_QUALITY, BROTLI_MAX_QUALITY);
+    BrotliEncoderSetParameter(this->state, BROTLI_PARAM_QUALITY, level);
+
+    this->buffer.resize(std::max<std::size_t>(blockSize, 4096));
+    this->nextOut = reinterpret_cast<uint8_t *>(this->buffer.data());
+    this->availOut = this->buffer.size();
+    return true;
+  }
+
+  /* Same contract as ArnelifyDeflater::write. */
+  bool write(const char *data, const std::size_t &length,
+             const bool &isFinish, const Output &output) {
+    const uint8_t *nextIn = reinterpret_cast<const uint8_t *>(data);
+    std::size_t availIn = length;
+    const BrotliEncoderOperation operation =
+        isFinish ? BROTLI_OPERATION_FINISH : BROTLI_OPERATION_PROCESS;
+
+    while (availIn || (isFinish && !BrotliEncoderIsFinished(this->state))) {
+      if (!this->availOut) {
+        if (!output(this->buffer.data(), this->buffer.size(), false)) {
+          return false;
+        }
+
+        this->nextOut = reinterpret_cast<uint8_t *>(this->buffer.data());
+        this->availOut = this->buffer.size();
+      }
+
+      const bool isOk = BrotliEncoderCompressStream(
+          this->state, operation, &availIn, &nextIn, &this->availOut,
+          &this->nextOut, nullptr);
+      if (!isOk) return false;
+    }
+
+    if (!isFinish) return true;
+    const std::size_t bytesCompressed = this->buffer.size() - this->availOut;
+    return output(this->buffer.data(), bytesCompressed, true);
+  }
+};
+
+#endif
+
+#endif
\ No newline at end of file
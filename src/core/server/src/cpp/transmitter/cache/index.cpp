@@ -0,0 +1,85 @@
+#ifndef ARNELIFY_CACHE_HPP
+#define ARNELIFY_CACHE_HPP
+
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sys/stat.h>
+#include <unordered_map>
+
+/* Compressed copies of files, shared by the workers of a server. An entry
+   remembers the file it was made from: a lookup with another inode, size
+   or mtime drops it. Least recently used entries are evicted once the
+   byte budget is exceeded. */
+class ArnelifyCache final {
+ public:
+  using Bytes = std::shared_ptr<const std::string>;
+
+ private:
+  struct Entry {
+    std::string key;
+    struct stat fileStat;
+    Bytes bytes;
+  };
+
+  std::size_t bytes;
+  const std::size_t capacity;
+  std::list<Entry> entries;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index;
+  std::mutex mutex;
+
+  void erase(const std::list<Entry>::iterator &it) {
+    this->bytes -= it->bytes->length();
+    this->index.erase(it->key);
+    this->entries.erase(it);
+  }
+
+ public:
+  ArnelifyCache(const std::size_t &c) : bytes(0), capacity(c) {}
+
+  Bytes get(const std::string &key, const struct stat &fileStat) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto it = this->index.find(key);
+    if (it == this->index.end()) return nullptr;
+
+    if (!isSame(it->second->fileStat, fileStat)) {
+      this->erase(it->second);
+      return nullptr;
+    }
+
+    this->entries.splice(this->entries.begin(), this->entries, it->second);
+    return it->second->bytes;
+  }
+
+  /* Both stats describe the same version of the same file. */
+  static bool isSame(const struct stat &a, const struct stat &b) {
+    return a.st_dev == b.st_dev && a.st_ino == b.st_ino &&
+           a.st_size == b.st_size && a.st_mtim.tv_sec == b.st_mtim.tv_sec &&
+           a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+  }
+
+  /* One file may take up to a quarter of the budget, so a single large
+     asset can't flush everything else. */
+  bool isCacheable(const std::size_t &fileSize) {
+    return fileSize && fileSize <= this->capacity / 4;
+  }
+
+  void set(const std::string &key, const struct stat &fileStat,
+           const Bytes &bytes) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto it = this->index.find(key);
+    if (it != this->index.end()) this->erase(it->second);
+    if (bytes->length() > this->capacity) return;
+
+    while (this->bytes + bytes->length() > this->capacity) {
+      this->erase(std::prev(this->entries.end()));
+    }
+
+    this->entries.push_front({key, fileStat, bytes});
+    this->index[key] = this->entries.begin();
+    this->bytes += bytes->length();
+  }
+};
+
+#endif
\ No newline at end of file
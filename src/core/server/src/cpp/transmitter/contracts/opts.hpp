@@ -7,13 +7,18 @@ struct ArnelifyTransmitterOpts final {
   const std::size_t TRANSMITTER_BLOCK_SIZE_KB;
   const std::string TRANSMITTER_CHARSET;
   const bool TRANSMITTER_GZIP;
+  const int TRANSMITTER_GZIP_LEVEL;
+  const std::size_t TRANSMITTER_GZIP_THRESHOLD;
   const std::string TRANSMITTER_CLIENT;
 
   ArnelifyTransmitterOpts(const std::size_t &bs, const std::string &ch,
-                          const bool &g, const std::string &cl)
+                          const bool &g, const std::string &cl,
+                          const int &gl = 6, const std::size_t &gt = 96)
       : TRANSMITTER_BLOCK_SIZE_KB(bs),
         TRANSMITTER_CHARSET(ch),
         TRANSMITTER_GZIP(g),
+        TRANSMITTER_GZIP_LEVEL(gl),
+        TRANSMITTER_GZIP_THRESHOLD(gt),
         TRANSMITTER_CLIENT(cl) {};
 };
 
@@ -0,0 +1,9 @@
+#ifndef ARNELIFY_TRANSMITTER_OUTPUT_HPP
+#define ARNELIFY_TRANSMITTER_OUTPUT_HPP
+
+#include <functional>
+
+using ArnelifyTransmitterOutput =
+    std::function<bool(const char*, std::size_t, bool)>;
+
+#endif
\ No newline at end of file
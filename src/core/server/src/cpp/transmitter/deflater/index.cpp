@@ -0,0 +1,98 @@
+#ifndef ARNELIFY_DEFLATER_HPP
+#define ARNELIFY_DEFLATER_HPP
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include <zlib.h>
+
+#include "../contracts/output.hpp"
+
+/* Gzip stream of a worker. deflateInit2 allocates about 256 KB of state,
+   so every thread keeps one stream and resets it between responses
+   instead of setting it up again. Output is handed over block by block. */
+class ArnelifyDeflater final {
+ private:
+  std::vector<char> buffer;
+  bool isReady;
+  int level;
+  z_stream zlib;
+
+  ArnelifyDeflater() : isReady(false), level(Z_DEFAULT_COMPRESSION) {
+    this->zlib.zalloc = Z_NULL;
+    this->zlib.zfree = Z_NULL;
+    this->zlib.opaque = Z_NULL;
+  }
+
+ public:
+  using Output = ArnelifyTransmitterOutput;
+
+  ArnelifyDeflater(const ArnelifyDeflater &) = delete;
+  ArnelifyDeflater &operator=(const ArnelifyDeflater &) = delete;
+
+  ~ArnelifyDeflater() {
+    if (this->isReady) deflateEnd(&this->zlib);
+  }
+
+  static ArnelifyDeflater &get() {
+    thread_local ArnelifyDeflater deflater;
+    return deflater;
+  }
+
+  /* Starts a new gzip member with output blocks of "blockSize" bytes. */
+  bool begin(int level, const std::size_t &blockSize) {
+    level = std::clamp(level, Z_NO_COMPRESSION, Z_BEST_COMPRESSION);
+    if (!this->isReady) {
+      const int ret = deflateInit2(&this->zlib, level, Z_DEFLATED, 15 + 16, 8,
+                                   Z_DEFAULT_STRATEGY);
+      if (ret != Z_OK) return false;
+      this->isReady = true;
+      this->level = level;
+    } else {
+      if (deflateReset(&this->zlib) != Z_OK) return false;
+      const bool isLevel = this->level != level;
+      if (isLevel) {
+        const int ret = deflateParams(&this->zlib, level, Z_DEFAULT_STRATEGY);
+        if (ret != Z_OK) return false;
+      }
+
+      this->level = level;
+    }
+
+    this->buffer.resize(std::max<std::size_t>(blockSize, 4096));
+    this->zlib.next_out = reinterpret_cast<Bytef *>(this->buffer.data());
+    this->zlib.avail_out = this->buffer.size();
+    return true;
+  }
+
+  /* Compresses "data". Every full output block goes to "output" with
+     isEnd set to false; once "isFinish" is set, the rest of the stream
+     follows with isEnd set to true. */
+  bool write(const char *data, const std::size_t &length,
+             const bool &isFinish, const Output &output) {
+    this->zlib.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    this->zlib.avail_in = length;
+
+    int ret = Z_OK;
+    while (this->zlib.avail_in || (isFinish && ret != Z_STREAM_END)) {
+      if (!this->zlib.avail_out) {
+        if (!output(this->buffer.data(), this->buffer.size(), false)) {
+          return false;
+        }
+
+        this->zlib.next_out = reinterpret_cast<Bytef *>(this->buffer.data());
+        this->zlib.avail_out = this->buffer.size();
+      }
+
+      ret = deflate(&this->zlib, isFinish ? Z_FINISH : Z_NO_FLUSH);
+      if (ret == Z_STREAM_ERROR) return false;
+    }
+
+    if (!isFinish) return true;
+    const std::size_t bytesCompressed =
+        this->buffer.size() - this->zlib.avail_out;
+    return output(this->buffer.data(), bytesCompressed, true);
+  }
+};
+
+#endif
\ No newline at end of file
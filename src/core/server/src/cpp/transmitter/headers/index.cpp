@@ -0,0 +1,74 @@
+#ifndef ARNELIFY_HEADERS_HPP
+#define ARNELIFY_HEADERS_HPP
+
+#include <algorithm>
+#include <iostream>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/* Response headers, kept in the name order they are sent in. Cleared
+   entries keep their strings, so a transmitter that is reused sets the
+   headers of the next response without allocating. */
+class ArnelifyHeaders final {
+ private:
+  using Header = std::pair<std::string, std::string>;
+
+  std::vector<Header> headers;
+  std::size_t length;
+
+  std::vector<Header>::iterator find(const std::string_view &key) {
+    const auto first = this->headers.begin();
+    const auto last = first + this->length;
+    return std::lower_bound(first, last, key,
+                            [](const Header &header,
+                               const std::string_view &key) {
+                              return header.first < key;
+                            });
+  }
+
+ public:
+  ArnelifyHeaders() : length(0) {}
+
+  std::vector<Header>::const_iterator begin() const {
+    return this->headers.begin();
+  }
+
+  std::vector<Header>::const_iterator end() const {
+    return this->headers.begin() + this->length;
+  }
+
+  void clear() { this->length = 0; }
+
+  void erase(const std::string_view &key) {
+    const auto it = this->find(key);
+    const auto last = this->headers.begin() + this->length;
+    const bool hasKey = it != last && it->first == key;
+    if (!hasKey) return;
+
+    std::rotate(it, it + 1, last);
+    this->length -= 1;
+  }
+
+  std::string &operator[](const std::string_view &key) {
+    const auto it = this->find(key);
+    const bool hasKey =
+        it != this->headers.begin() + this->length && it->first == key;
+    if (hasKey) return it->second;
+
+    const std::size_t index = it - this->headers.begin();
+    if (this->length == this->headers.size()) this->headers.emplace_back();
+
+    Header &header = this->headers[this->length];
+    header.first = key;
+    header.second.clear();
+
+    const auto first = this->headers.begin();
+    std::rotate(first + index, first + this->length,
+                first + this->length + 1);
+    this->length += 1;
+    return this->headers[index].second;
+  }
+};
+
+#endif
\ No newline at end of file
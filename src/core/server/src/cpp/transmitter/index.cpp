@@ -2,21 +2,41 @@
 #define ARNELIFY_TRANSMITTER_HPP
 
 #include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <optional>
+#include <poll.h>
+#include <random>
+#include <string_view>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
 #include <unistd.h>
+#include <vector>
 #include <zlib.h>
 
+#include "brotli/index.cpp"
+#include "cache/index.cpp"
 #include "contracts/callback.hpp"
 #include "contracts/opts.hpp"
+#include "deflater/index.cpp"
+#include "encoding/index.cpp"
+#include "headers/index.cpp"
+#include "range/index.cpp"
+#include "../writer/index.cpp"
+#include "zstd/index.cpp"
 
 class ArnelifyTransmitter final {
  private:
+  std::string acceptEncoding;
   std::size_t blockSize;
   std::string body;
+  ArnelifyCache *cache;
   ArnelifyTransmitterCallback callback = [](const std::string &message,
                                             const bool &isError) {
     if (isError) {
@@ -28,100 +48,195 @@ class ArnelifyTransmitter final {
   };
 
   int code;
+  std::string compressed;
+  std::string encoding;
   std::filesystem::path filePath;
-  bool isGzip;
+  bool isChunked;
+  bool isKeepAlive;
   bool isStatic;
-  std::map<std::string, std::string> headers;
+  bool isStreaming;
+  std::string head;
+  ArnelifyHeaders headers;
+  std::string ifModifiedSince;
+  std::string ifNoneMatch;
+  std::string ifRange;
   const ArnelifyTransmitterOpts opts;
-  const int socket;
-
-  const std::string getMime(const std::string &extension) {
-    const std::string &charset = this->opts.TRANSMITTER_CHARSET;
-    const std::map<const std::string, const std::string> mime = {
-        {".avi", "video/x-msvideo"},
-        {".css", "text/css; charset=" + charset},
-        {".csv", "text/csv; charset=" + charset},
-        {".eot", "font/eot"},
-        {".gif", "image/gif"},
-        {".htm", "text/html; charset=" + charset},
-        {".html", "text/html; charset=" + charset},
-        {".ico", "image/x-icon"},
-        {".jpeg", "image/jpeg"},
-        {".jpg", "image/jpeg"},
-        {".js", "application/javascript; charset=" + charset},
-        {".json", "application/json; charset=" + charset},
-        {".mkv", "video/x-matroska"},
-        {".mov", "video/quicktime"},
-        {".mp3", "audio/mpeg"},
-        {".mp4", "video/mp4"},
-        {".otf", "font/otf"},
-        {".png", "image/png"},
-        {".svg", "image/svg+xml; charset=" + charset},
-        {".ttf", "font/ttf"},
-        {".txt", "text/plain; charset=" + charset},
-        {".wasm", "application/wasm"},
-        {".wav", "audio/wav"},
-        {".weba", "audio/webm"},
-        {".webp", "image/webp"},
-        {".woff", "font/woff"},
-        {".woff2", "font/woff2"},
-        {".xml", "application/xml; charset=" + charset}};
+  std::string range;
+  int socket;
+
+  /* HTTP-date of a file time, as used by Last-Modified. */
+  const std::string getDate(const time_t &time) {
+    std::tm tm;
+    gmtime_r(&time, &tm);
+    char date[32];
+    const std::size_t length =
+        std::strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return std::string(date, length);
+  }
+
+  /* ETag of a file, derived from its modification time and size. */
+  const std::string getETag(const struct stat &fileStat) {
+    char etag[64];
+    const int length = std::snprintf(
+        etag, sizeof(etag), "\"%llx-%lx-%llx\"",
+        static_cast<unsigned long long>(fileStat.st_mtim.tv_sec),
+        static_cast<unsigned long>(fileStat.st_mtim.tv_nsec),
+        static_cast<unsigned long long>(fileStat.st_size));
+    return std::string(etag, length);
+  }
 
+  /* Sets the Content-Type of "extension" in place, which keeps the
+     capacity of the header between responses. */
+  void setMime(const std::string &extension) {
+    /* Built once, the charset of text types is appended per response. */
+    static const std::map<std::string, std::pair<std::string, bool>> mime = {
+        {".avi", {"video/x-msvideo", false}},
+        {".css", {"text/css", true}},
+        {".csv", {"text/csv", true}},
+        {".eot", {"font/eot", false}},
+        {".gif", {"image/gif", false}},
+        {".htm", {"text/html", true}},
+        {".html", {"text/html", true}},
+        {".ico", {"image/x-icon", false}},
+        {".jpeg", {"image/jpeg", false}},
+        {".jpg", {"image/jpeg", false}},
+        {".js", {"application/javascript", true}},
+        {".json", {"application/json", true}},
+        {".mkv", {"video/x-matroska", false}},
+        {".mov", {"video/quicktime", false}},
+        {".mp3", {"audio/mpeg", false}},
+        {".mp4", {"video/mp4", false}},
+        {".otf", {"font/otf", false}},
+        {".png", {"image/png", false}},
+        {".svg", {"image/svg+xml", true}},
+        {".ttf", {"font/ttf", false}},
+        {".txt", {"text/plain", true}},
+        {".wasm", {"application/wasm", false}},
+        {".wav", {"audio/wav", false}},
+        {".weba", {"audio/webm", false}},
+        {".webp", {"image/webp", false}},
+        {".woff", {"font/woff", false}},
+        {".woff2", {"font/woff2", false}},
+        {".xml", {"application/xml", true}}};
+
+    std::string &contentType = this->headers["Content-Type"];
     auto it = mime.find(extension);
     const bool hasMime = it != mime.end();
-    if (hasMime) {
-      return it->second;
+    if (!hasMime) {
+      contentType = "application/octet-stream";
+      return;
     }
 
-    return "application/octet-stream";
-  }
-
-  const void gzip(const char *data, const uInt &bytesRead,
-                  unsigned char *&compressed, std::size_t &bytesCompressed) {
-    z_stream zlib;
-    zlib.zalloc = Z_NULL;
-    zlib.zfree = Z_NULL;
-    zlib.opaque = Z_NULL;
-    int ret = deflateInit2(&zlib, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
-                           Z_DEFAULT_STRATEGY);
-    if (ret != Z_OK) {
-      this->callback("deflateInit2 failed with error: ", true);
-      std::cout << "Zlib error: " << ret << std::endl;
-      deflateEnd(&zlib);
-      return;
+    const auto &[type, hasCharset] = it->second;
+    contentType = type;
+    if (!hasCharset) return;
+    contentType += "; charset=";
+    contentType += this->opts.TRANSMITTER_CHARSET;
+  }
+
+  /* If-None-Match uses the weak comparison: "W/" prefixes are ignored. */
+  bool hasETag(std::string_view list, std::string_view etag) {
+    const auto strip = [](std::string_view value) {
+      value = ArnelifyRange::trim(value);
+      if (value.substr(0, 2) == "W/") value.remove_prefix(2);
+      return value;
+    };
+
+    etag = strip(etag);
+    while (true) {
+      const std::size_t commaStart = list.find(',');
+      const std::string_view candidate = strip(list.substr(0, commaStart));
+      if (candidate == "*" || candidate == etag) return true;
+      if (commaStart == std::string_view::npos) return false;
+      list.remove_prefix(commaStart + 1);
     }
+  }
 
-    zlib.next_in = (unsigned char *)data;
-    zlib.avail_in = bytesRead;
+  /* Text types are worth compressing, most binary ones are compressed
+     already. */
+  bool isCompressible(const std::string &type) {
+    return type.find("; charset=") != std::string::npos ||
+           type.rfind("text/", 0) == 0 ||
+           type.find("json") != std::string::npos ||
+           type.find("javascript") != std::string::npos ||
+           type.find("xml") != std::string::npos;
+  }
 
-    zlib.avail_out = this->blockSize;
-    zlib.next_out = compressed;
-    ret = deflate(&zlib, Z_FINISH);
-    if (ret == Z_STREAM_ERROR) {
-      this->callback("deflateInit2 failed with error: ", true);
-      std::cout << "Zlib error: " << ret << std::endl;
-      deflateEnd(&zlib);
-      return;
+  /* The client copy is current: If-None-Match wins over If-Modified-Since,
+     which only compares whole seconds. */
+  bool isNotModified(const std::string &etag, const time_t &modified) {
+    const bool hasIfNoneMatch = !this->ifNoneMatch.empty();
+    if (hasIfNoneMatch) return this->hasETag(this->ifNoneMatch, etag);
+    if (this->ifModifiedSince.empty()) return false;
+
+    std::tm tm{};
+    const char *end = strptime(this->ifModifiedSince.c_str(),
+                               "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if (!end) return false;
+    return modified <= timegm(&tm);
+  }
+
+  /* If-Range only keeps the Range when the validator is the current one:
+     a strong ETag or the exact Last-Modified date. */
+  bool isRangeFresh(const std::string &etag, const std::string &modified) {
+    if (this->ifRange.empty()) return true;
+    const bool isWeak = this->ifRange.substr(0, 2) == "W/";
+    if (isWeak) return false;
+    return this->ifRange == etag || this->ifRange == modified;
+  }
+
+  /* Output of the compression stream. A stream that fits in one block
+     leaves with a Content-Length; a longer one switches to chunked
+     transfer, except for HTTP/1.0 clients, whose stream is collected and
+     sent whole. */
+  bool onCompressed(const char *data, const std::size_t &length,
+                    const bool &isEnd) {
+    if (this->isStreaming) {
+      if (!this->sendChunk(data, length)) return false;
+      return !isEnd || this->write("0\r\n\r\n", 5);
+    }
+
+    if (!isEnd && !this->isChunked) {
+      this->compressed.append(data, length);
+      return true;
     }
 
-    bytesCompressed += this->blockSize - zlib.avail_out;
-    deflateEnd(&zlib);
+    if (!isEnd) {
+      this->headers.erase("Content-Length");
+      this->headers["Transfer-Encoding"] = "chunked";
+      this->setCork(true);
+      this->sendHeaders();
+      this->isStreaming = true;
+      return this->sendChunk(data, length);
+    }
+
+    const std::size_t bytesCompressed = this->compressed.length() + length;
+    this->headers["Content-Length"] = std::to_string(bytesCompressed);
+    std::string &response = this->getHeaders();
+    response.append(this->compressed);
+    response.append(data, length);
+    return this->write(response.c_str(), response.length());
   }
 
   void resetHeaders(const bool &init = false) {
     if (!init) this->headers.clear();
 
-    this->headers["Connection"] = "close";
+    this->headers["Connection"] = this->isKeepAlive ? "keep-alive" : "close";
     this->headers["Content-Length"] = "0";
-    this->headers["Content-Type"] = this->getMime(".json");
+    this->setMime(".json");
     this->headers["Server"] = "Arnelify Server";
   }
 
-  const void sendHeaders() {
-    std::string response = "HTTP/1.1";
-    response.append(" ");
+  /* Writes the status line and headers into a buffer the transmitter
+     keeps, so the caller may append the body to it. */
+  std::string &getHeaders() {
+    std::string &response = this->head;
+    response = "HTTP/1.1 ";
 
     switch (this->code) {
+      case 503:
+        response.append("503 Service Unavailable");
+        break;
       case 500:
         response.append("500 Internal Server Error");
         break;
@@ -137,8 +252,14 @@ class ArnelifyTransmitter final {
       case 401:
         response.append("401 Unauthorized");
         break;
+      case 416:
+        response.append("416 Range Not Satisfiable");
+        break;
+      case 304:
+        response.append("304 Not Modified");
+        break;
       case 206:
-        response.append("206 Partial");
+        response.append("206 Partial Content");
         break;
       default:
         response.append("200 OK");
@@ -146,73 +267,384 @@ class ArnelifyTransmitter final {
     }
 
     response.append(" \r\n");
-    for (const auto &pair : this->headers) {
-      response.append(pair.first + ": " + pair.second + "\r\n");
+    this->isKeepAlive = this->headers["Connection"] == "keep-alive";
+    for (const auto &[key, value] : this->headers) {
+      response.append(key);
+      response.append(": ");
+      response.append(value);
+      response.append("\r\n");
     }
 
     response.append("\r\n");
-    send(this->socket, response.c_str(), response.length(), 0);
     this->resetHeaders();
+    return response;
+  }
+
+  void sendHeaders() {
+    const std::string &response = this->getHeaders();
+    this->write(response.c_str(), response.length());
   }
 
+  /* Like small files, a small body leaves in one write with its headers:
+     sent on its own, it would wait for the delayed ACK of the headers. */
   void sendBody(const std::size_t &bytesRead) {
     this->headers["Content-Length"] = std::to_string(bytesRead);
-    this->sendHeaders();
+    const bool isSmall = bytesRead <= 16384;
+    if (isSmall) {
+      std::string &response = this->getHeaders();
+      response.append(this->body, 0, bytesRead);
+      this->write(response.c_str(), response.length());
+      this->body.clear();
+      return;
+    }
 
-    send(this->socket, this->body.c_str(), bytesRead, 0);
+    this->setCork(true);
+    this->sendHeaders();
+    this->write(this->body.c_str(), bytesRead);
+    this->setCork(false);
     this->body.clear();
   }
 
-  void sendBodyCompressed(const std::size_t &bytesRead) {
-    std::size_t bytesCompressed = 0;
-    unsigned char *compressed = new unsigned char[this->blockSize];
-    this->gzip(this->body.c_str(), bytesRead, compressed, bytesCompressed);
-    this->body.clear();
+  bool sendChunk(const char *data, const std::size_t &length) {
+    char size[24];
+    const int sizeLen = std::snprintf(size, sizeof(size), "%zx\r\n", length);
+    if (!this->write(size, sizeLen)) return false;
+    if (!this->write(data, length)) return false;
+    return this->write("\r\n", 2);
+  }
 
-    this->headers["Content-Encoding"] = "gzip";
-    this->headers["Content-Length"] = std::to_string(bytesCompressed);
-    this->sendHeaders();
+  /* Runs the body or, when "file" is open, the file through the stream
+     of the chosen encoding. Returns false when no stream could be set up,
+     so the caller can send the bytes as they are. */
+  bool compress(const int &file, const std::size_t &length,
+                const ArnelifyTransmitterOutput &output) {
+    /* The gzip level is carried over to the scales of brotli and zstd:
+       the default of 6 gives brotli 5 and zstd 3. */
+    const int level = this->opts.TRANSMITTER_GZIP_LEVEL;
+#ifdef ARNELIFY_HAS_BROTLI
+    if (this->encoding == "br") {
+      return this->compress(ArnelifyBrotli::get(), level - 1, file, length,
+                            output);
+    }
+#endif
+#ifdef ARNELIFY_HAS_ZSTD
+    if (this->encoding == "zstd") {
+      return this->compress(ArnelifyZstd::get(), (level + 1) / 2, file,
+                            length, output);
+    }
+#endif
+    return this->compress(ArnelifyDeflater::get(), level, file, length,
+                          output);
+  }
 
-    send(this->socket, compressed, bytesCompressed, 0);
-    delete[] compressed;
+  /* Block of at least "size" bytes that files are read into for their
+     stream. Like the streams, it is kept by the thread. */
+  static char *getBlock(const std::size_t &size) {
+    thread_local std::vector<char> block;
+    if (block.size() < size) block.resize(size);
+    return block.data();
   }
 
-  void sendFile(std::ifstream &file, const std::size_t &fileSize) {
-    this->headers["Content-Length"] = std::to_string(fileSize);
+  template <typename Encoder>
+  bool compress(Encoder &encoder, const int &level, const int &file,
+                const std::size_t &length,
+                const ArnelifyTransmitterOutput &output) {
+    const bool isReady = encoder.begin(level, this->blockSize);
+    if (!isReady) {
+      this->callback("Failed to start the " + this->encoding + " stream.",
+                     true);
+      return false;
+    }
+
+    const bool hasFile = file != -1;
+    char *block = hasFile ? getBlock(this->blockSize) : nullptr;
+    std::size_t offset = 0;
+    while (true) {
+      std::size_t bytesRead = std::min(this->blockSize, length - offset);
+      const char *data = this->body.data() + offset;
+      if (hasFile) {
+        const ssize_t count = pread(file, block, bytesRead, offset);
+        if (count < 0 && errno == EINTR) continue;
+        bytesRead = count > 0 ? count : 0;
+        data = block;
+      }
+
+      offset += bytesRead;
+      const bool isFinish = offset >= length || !bytesRead;
+      const bool isSent = encoder.write(data, bytesRead, isFinish, output);
+      if (!isSent || isFinish) break;
+    }
+
+    return true;
+  }
+
+  /* A file small enough for the cache is compressed once and then served
+     from memory until it changes on disk. */
+  bool sendCached(const int &file, const struct stat &fileStat) {
+    const bool isCacheable = this->cache &&
+                             this->cache->isCacheable(fileStat.st_size);
+    if (!isCacheable) return false;
+
+    const std::string key = this->encoding + ":" + this->filePath.string();
+    ArnelifyCache::Bytes bytes = this->cache->get(key, fileStat);
+    if (!bytes) {
+      std::string compressed;
+      const bool isCompressed = this->compress(
+          file, fileStat.st_size,
+          [&compressed](const char *data, std::size_t length, bool) {
+            compressed.append(data, length);
+            return true;
+          });
+      if (!isCompressed) return false;
+
+      bytes = std::make_shared<const std::string>(std::move(compressed));
+      /* A file rewritten while it was read must not be cached. */
+      struct stat afterStat;
+      const bool isSame = fstat(file, &afterStat) == 0 &&
+                          ArnelifyCache::isSame(afterStat, fileStat);
+      if (isSame) this->cache->set(key, fileStat, bytes);
+    }
+
+    this->headers["Content-Encoding"] = this->encoding;
+    this->headers["Content-Length"] = std::to_string(bytes->length());
+    std::string &response = this->getHeaders();
+    const bool isSmall = bytes->length() <= 16384;
+    if (isSmall) {
+      response.append(*bytes);
+      this->write(response.c_str(), response.length());
+      return true;
+    }
+
+    this->setCork(true);
+    const bool isSent = this->write(response.c_str(), response.length());
+    if (isSent) this->write(bytes->data(), bytes->length());
+    this->setCork(false);
+    return true;
+  }
+
+  bool sendCompressed(const int &file, const std::size_t &length) {
+    this->headers["Content-Encoding"] = this->encoding;
+    const bool isCompressed = this->compress(
+        file, length, [this](const char *data, std::size_t length, bool isEnd) {
+          return this->onCompressed(data, length, isEnd);
+        });
+    if (!isCompressed) {
+      this->headers.erase("Content-Encoding");
+      return false;
+    }
+
+    if (this->isStreaming) this->setCork(false);
+    this->compressed.clear();
+    this->isStreaming = false;
+    this->body.clear();
+    return true;
+  }
+
+  /* Headers and file leave in full segments: the socket is corked until
+     the kernel has copied the file straight from the page cache. */
+  void sendFile(const int &file, const std::size_t &offset,
+                const std::size_t &length) {
+    this->headers["Content-Length"] = std::to_string(length);
+
+    /* A small file costs less to copy behind the headers than the extra
+       syscalls of corking, so it leaves in a single write. */
+    const bool isSmall = length <= 16384;
+    if (isSmall) {
+      std::string &response = this->getHeaders();
+      const std::size_t headersLen = response.length();
+      response.resize(headersLen + length);
+      std::size_t bytesTotal = 0;
+      while (bytesTotal < length) {
+        const ssize_t bytesRead =
+            pread(file, response.data() + headersLen + bytesTotal,
+                  length - bytesTotal, offset + bytesTotal);
+        if (bytesRead < 0 && errno == EINTR) continue;
+        if (bytesRead <= 0) break;
+        bytesTotal += bytesRead;
+      }
+
+      this->write(response.c_str(), headersLen + bytesTotal);
+      return;
+    }
+
+    this->setCork(true);
     this->sendHeaders();
+    this->sendFileRange(file, offset, length);
+    this->setCork(false);
+  }
 
+  void sendFileBlocks(const int &file, off_t offset, const std::size_t &end) {
     char *block = new char[this->blockSize];
-    while (file.read(block, this->blockSize) || file.gcount() > 0) {
-      const std::size_t bytesRead = file.gcount();
-      send(this->socket, block, bytesRead, 0);
+    while (static_cast<std::size_t>(offset) < end) {
+      const std::size_t bytesLeft = end - offset;
+      const ssize_t bytesRead =
+          pread(file, block, std::min(this->blockSize, bytesLeft), offset);
+      if (bytesRead < 0 && errno == EINTR) continue;
+      if (bytesRead <= 0) break;
+      if (!this->write(block, bytesRead)) break;
+      offset += bytesRead;
     }
 
     delete[] block;
   }
 
-  void sendFileCompressed(std::ifstream &file) {
-    char *block = new char[this->blockSize];
-    file.read(block, this->blockSize);
+  bool sendFileRange(const int &file, const std::size_t &start,
+                     const std::size_t &length) {
+    off_t offset = start;
+    const std::size_t end = start + length;
+    while (static_cast<std::size_t>(offset) < end) {
+      const ssize_t bytesSent =
+          sendfile(this->socket, file, &offset, end - offset);
+      if (bytesSent > 0) continue;
+      if (bytesSent == 0) return false;
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN && this->wait()) continue;
+
+      const bool isUnsupported = errno == EINVAL || errno == ENOSYS;
+      if (isUnsupported) this->sendFileBlocks(file, offset, end);
+      return isUnsupported;
+    }
 
-    std::size_t bytesCompressed = 0;
-    unsigned char *compressed = new unsigned char[this->blockSize];
-    this->gzip(block, file.gcount(), compressed, bytesCompressed);
-    delete[] block;
+    return true;
+  }
 
-    this->headers["Content-Encoding"] = "gzip";
-    this->headers["Content-Length"] = std::to_string(bytesCompressed);
+  /* Several ranges leave as one multipart/byteranges body. Part headers
+     are built up front, since Content-Length has to cover them. */
+  void sendFileRanges(const int &file,
+                      const std::vector<ArnelifyRange::Slice> &slices,
+                      const std::size_t &fileSize) {
+    static thread_local std::mt19937_64 rng(std::random_device{}());
+    char boundary[24];
+    std::snprintf(boundary, sizeof(boundary), "%016llx",
+                  static_cast<unsigned long long>(rng()));
+
+    const std::string contentType = this->headers["Content-Type"];
+    const std::string size = std::to_string(fileSize);
+    std::vector<std::string> parts;
+    std::size_t length = 0;
+    for (const ArnelifyRange::Slice &slice : slices) {
+      std::string part = parts.empty() ? "" : "\r\n";
+      part += "--" + std::string(boundary) + "\r\n";
+      part += "Content-Type: " + contentType + "\r\n";
+      part += "Content-Range: bytes " + std::to_string(slice.start) + "-" +
+              std::to_string(slice.start + slice.length - 1) + "/" + size +
+              "\r\n\r\n";
+      length += part.length() + slice.length;
+      parts.push_back(std::move(part));
+    }
+
+    const std::string tail = "\r\n--" + std::string(boundary) + "--\r\n";
+    length += tail.length();
+
+    this->headers["Content-Length"] = std::to_string(length);
+    this->headers["Content-Type"] =
+        "multipart/byteranges; boundary=" + std::string(boundary);
+    this->setCork(true);
     this->sendHeaders();
+    for (std::size_t i = 0; i < slices.size(); ++i) {
+      const std::string &part = parts[i];
+      if (!this->write(part.c_str(), part.length())) break;
+      if (!this->sendFileRange(file, slices[i].start, slices[i].length)) break;
+      if (i + 1 == slices.size()) this->write(tail.c_str(), tail.length());
+    }
+
+    this->setCork(false);
+  }
+
+  /* A precompressed "file.br", "file.zst" or "file.gz" next to the file
+     is sent as it is, as long as it is not older than the file. They are
+     tried in the order the client prefers them. */
+  bool sendSidecar(const struct stat &fileStat,
+                   const std::vector<std::string_view> &codings) {
+    for (const std::string_view &coding : codings) {
+      const char *extension = coding == "br"     ? ".br"
+                              : coding == "zstd" ? ".zst"
+                                                 : ".gz";
+      const std::string path = this->filePath.string() + extension;
+      const int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (file == -1) continue;
+
+      struct stat sidecarStat;
+      const bool isFresh =
+          fstat(file, &sidecarStat) == 0 && S_ISREG(sidecarStat.st_mode) &&
+          (sidecarStat.st_mtim.tv_sec > fileStat.st_mtim.tv_sec ||
+           (sidecarStat.st_mtim.tv_sec == fileStat.st_mtim.tv_sec &&
+            sidecarStat.st_mtim.tv_nsec >= fileStat.st_mtim.tv_nsec));
+      if (isFresh) {
+        this->headers["Content-Encoding"] = std::string(coding);
+        this->setVary();
+        this->sendFile(file, 0, sidecarStat.st_size);
+      }
+
+      close(file);
+      if (isFresh) return true;
+    }
+
+    return false;
+  }
+
+  /* Picks the first of "codings" this build can compress with. */
+  bool setEncoder(const std::vector<std::string_view> &codings) {
+    for (const std::string_view &coding : codings) {
+      if (!ArnelifyEncoding::hasEncoder(coding)) continue;
+      this->encoding = coding;
+      return true;
+    }
+
+    return false;
+  }
 
-    send(this->socket, compressed, bytesCompressed, 0);
-    delete[] compressed;
+  /* Caches must keep the variants of a response apart once its encoding
+     depends on the request. */
+  void setVary() {
+    std::string &vary = this->headers["Vary"];
+    if (vary.find("Accept-Encoding") != std::string::npos) return;
+    vary += vary.empty() ? "Accept-Encoding" : ", Accept-Encoding";
+  }
+
+  void setCork(const bool &isCork) {
+    const int flag = isCork ? 1 : 0;
+    setsockopt(this->socket, IPPROTO_TCP, TCP_CORK, &flag, sizeof(flag));
+  }
+
+  /* Waits until a non-blocking socket can take more bytes. */
+  bool wait() {
+    pollfd pfd{this->socket, POLLOUT, 0};
+    while (true) {
+      const int ready = poll(&pfd, 1, 30000);
+      if (ready > 0) return !(pfd.revents & (POLLERR | POLLHUP));
+      if (ready < 0 && errno == EINTR) continue;
+      return false;
+    }
+  }
+
+  bool write(const char *data, std::size_t length) {
+    while (length) {
+      const ssize_t bytesSent = send(this->socket, data, length, MSG_NOSIGNAL);
+      if (bytesSent > 0) {
+        data += bytesSent;
+        length -= bytesSent;
+        continue;
+      }
+
+      if (bytesSent < 0 && errno == EINTR) continue;
+      if (bytesSent < 0 && errno == EAGAIN && this->wait()) continue;
+      return false;
+    }
+
+    return true;
   }
 
  public:
-  ArnelifyTransmitter(const int &s, ArnelifyTransmitterOpts &o)
+  ArnelifyTransmitter(const int &s, ArnelifyTransmitterOpts &o,
+                      ArnelifyCache *c = nullptr)
       : blockSize(65536),
+        cache(c),
         code(200),
-        isGzip(false),
+        isChunked(true),
+        isKeepAlive(false),
         isStatic(false),
+        isStreaming(false),
         opts(o),
         socket(s) {
     this->blockSize = this->opts.TRANSMITTER_BLOCK_SIZE_KB * 1024;
@@ -230,30 +662,117 @@ class ArnelifyTransmitter final {
     this->body.append(body);
   }
 
+  /* Serializes "json" straight into the body buffer, which keeps its
+     capacity between the responses of a connection. */
+  void addJson(const Json::Value &json) {
+    const bool hasFile = !this->filePath.empty();
+    if (hasFile) {
+      this->callback("Can't add body to a Response that contains a file.",
+                     true);
+      exit(1);
+    }
+
+    ArnelifyWriter::write(json, this->body);
+  }
+
   void end() {
     const bool hasFile = !this->filePath.empty();
     if (hasFile) {
       this->body.clear();
-      std::ifstream file(this->filePath, std::ios::binary);
-      if (file.is_open()) {
-        const std::size_t fileSize = std::filesystem::file_size(this->filePath);
+      const int file = open(this->filePath.c_str(), O_RDONLY | O_CLOEXEC);
+      struct stat fileStat;
+      const bool isOpen = file != -1 && fstat(file, &fileStat) == 0 &&
+                          S_ISREG(fileStat.st_mode);
+      if (isOpen) {
+        const std::size_t fileSize = fileStat.st_size;
         const std::string fileExt = filePath.extension().string();
         const std::string fileName = filePath.filename().string();
-        this->headers["Content-Type"] = getMime(fileExt);
+        this->setMime(fileExt);
         if (!this->isStatic) {
           this->headers["Content-Disposition"] =
               "attachment; filename=\"" + fileName + "\"";
         }
 
-        if (this->isGzip && this->blockSize > fileSize && fileSize > 96) {
-          this->sendFileCompressed(file);
+        const bool isOk = this->code == 200;
+        const std::string etag = this->getETag(fileStat);
+        const std::string modified = this->getDate(fileStat.st_mtim.tv_sec);
+        if (isOk) {
+          this->headers["Accept-Ranges"] = "bytes";
+          this->headers["ETag"] = etag;
+          this->headers["Last-Modified"] = modified;
+        }
+
+        const bool isNotModified =
+            isOk && this->isNotModified(etag, fileStat.st_mtim.tv_sec);
+        if (isNotModified) {
+          this->code = 304;
+          this->headers.erase("Content-Disposition");
+          this->headers.erase("Content-Length");
+          this->headers.erase("Content-Type");
+          this->sendHeaders();
+          close(file);
+          return;
+        }
+
+        std::vector<ArnelifyRange::Slice> slices;
+        const bool hasRange =
+            isOk && !this->range.empty() &&
+            this->isRangeFresh(etag, modified) &&
+            ArnelifyRange::parse(this->range, fileSize, slices);
+        if (hasRange) {
+          const std::string size = std::to_string(fileSize);
+          if (slices.empty()) {
+            this->code = 416;
+            this->headers["Content-Range"] = "bytes */" + size;
+            this->sendBody(0);
+            close(file);
+            return;
+          }
+
+          this->code = 206;
+          if (slices.size() > 1) {
+            this->sendFileRanges(file, slices, fileSize);
+            close(file);
+            return;
+          }
+
+          const ArnelifyRange::Slice &slice = slices.front();
+          this->headers["Content-Range"] =
+              "bytes " + std::to_string(slice.start) + "-" +
+              std::to_string(slice.start + slice.length - 1) + "/" + size;
+          this->sendFile(file, slice.start, slice.length);
+          close(file);
           return;
         }
 
-        this->sendFile(file, fileSize);
+        /* Binary files are mostly compressed already, only text types
+           are worth the CPU once they no longer fit in a block. */
+        const bool isText = this->isCompressible(this->headers["Content-Type"]);
+        const bool isCandidate =
+            fileSize > this->opts.TRANSMITTER_GZIP_THRESHOLD &&
+            (this->blockSize > fileSize || isText);
+        if (isCandidate && this->opts.TRANSMITTER_GZIP) this->setVary();
+
+        const std::vector<std::string_view> codings =
+            ArnelifyEncoding::negotiate(this->acceptEncoding, fileSize);
+        const bool isCompress = isCandidate && this->setEncoder(codings);
+        if (isOk) this->headers["ETag"] = "W/" + etag;
+        const bool isSidecar = this->sendSidecar(fileStat, codings);
+        const bool isSent =
+            isSidecar || (isCompress && (this->sendCached(file, fileStat) ||
+                                         this->sendCompressed(file, fileSize)));
+        if (isSent) {
+          close(file);
+          return;
+        }
+
+        if (isOk) this->headers["ETag"] = etag;
+        this->sendFile(file, 0, fileSize);
+        close(file);
         return;
       }
 
+      if (file != -1) close(file);
       this->code = 404;
       this->body = "{\"code\":404,\"Not found.\"}";
       this->callback("Failed to open file: " + std::string(this->filePath),
@@ -261,25 +780,64 @@ class ArnelifyTransmitter final {
     }
 
     const std::size_t bytesRead = this->body.length();
-    if (this->isGzip && this->blockSize > bytesRead && bytesRead > 96) {
-      this->sendBodyCompressed(bytesRead);
-      return;
-    }
+    const bool isCandidate =
+        bytesRead > this->opts.TRANSMITTER_GZIP_THRESHOLD &&
+        this->isCompressible(this->headers["Content-Type"]);
+    if (isCandidate && this->opts.TRANSMITTER_GZIP) this->setVary();
+
+    const bool isCompress =
+        isCandidate && this->setEncoder(ArnelifyEncoding::negotiate(
+                           this->acceptEncoding, bytesRead));
+    if (isCompress && this->sendCompressed(-1, bytesRead)) return;
 
     this->sendBody(bytesRead);
   }
 
+  bool getKeepAlive() { return this->isKeepAlive; }
+
+  void reset() {
+    this->acceptEncoding.clear();
+    this->body.clear();
+    this->code = 200;
+    this->encoding.clear();
+    this->filePath.clear();
+    this->ifModifiedSince.clear();
+    this->ifNoneMatch.clear();
+    this->ifRange.clear();
+    this->isChunked = true;
+    this->isStatic = false;
+    this->range.clear();
+    this->resetHeaders();
+  }
+
+  /* Readies a transmitter kept from a closed connection for the next one.
+     A buffer a large response has grown past a few dozen kilobytes is
+     let go rather than kept for as long as the transmitter lives. */
+  void recycle() {
+    this->reset();
+    this->compressed.clear();
+    this->isKeepAlive = false;
+    this->isStreaming = false;
+    for (std::string *buffer : {&this->body, &this->compressed, &this->head}) {
+      if (buffer->capacity() > 65536) std::string().swap(*buffer);
+    }
+  }
+
   void setCallback(const ArnelifyTransmitterCallback &callback) {
     this->callback = callback;
   }
 
   void setCode(const int &code) { this->code = code; }
 
-  void setEncoding(const std::string &encoding) {
-    const std::size_t gzipStart = encoding.find("gzip");
-    if (this->opts.TRANSMITTER_GZIP) {
-      this->isGzip = gzipStart != std::string::npos;
-    }
+  /* Accept-Encoding of the request. It is negotiated per response, since
+     the choice depends on the size and type of what is sent. */
+  void setEncoding(const std::string_view &acceptEncoding) {
+    if (this->opts.TRANSMITTER_GZIP) this->acceptEncoding = acceptEncoding;
+  }
+
+  void setKeepAlive(const bool &isKeepAlive) {
+    this->isKeepAlive = isKeepAlive;
+    this->headers["Connection"] = isKeepAlive ? "keep-alive" : "close";
   }
 
   void setFile(const std::filesystem::path &filePath,
@@ -298,6 +856,28 @@ class ArnelifyTransmitter final {
   void setHeader(const std::string &key, const std::string &value) {
     this->headers[key] = value;
   }
+
+  /* Range and If-Range of the request, applied to file responses only. */
+  void setRange(const std::string_view &range,
+                const std::string_view &ifRange) {
+    this->range = range;
+    this->ifRange = ifRange;
+  }
+
+  /* If-None-Match and If-Modified-Since of the request. A file response
+     that still matches them is answered with 304 and no body. */
+  void setValidators(const std::string_view &ifNoneMatch,
+                     const std::string_view &ifModifiedSince) {
+    this->ifNoneMatch = ifNoneMatch;
+    this->ifModifiedSince = ifModifiedSince;
+  }
+
+  void setSocket(const int &socket) { this->socket = socket; }
+
+  /* Chunked transfer is only used with HTTP/1.1 clients. */
+  void setVersion(const std::string_view &version) {
+    this->isChunked = version == "HTTP/1.1";
+  }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,106 @@
+#ifndef ARNELIFY_RANGE_HPP
+#define ARNELIFY_RANGE_HPP
+
+#include <algorithm>
+#include <charconv>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+/* Byte ranges of a file response. A Range header is resolved against the
+   file size into sorted slices; overlapping and adjacent ones are merged,
+   so a client can't make one file cost more than its size to send. */
+class ArnelifyRange final {
+ private:
+  static constexpr std::size_t MAX_RANGES = 64;
+
+  static bool toNumber(const std::string_view &value, std::size_t &number) {
+    const char *end = value.data() + value.length();
+    const auto [ptr, ec] = std::from_chars(value.data(), end, number);
+    return !value.empty() && ec == std::errc() && ptr == end;
+  }
+
+ public:
+  struct Slice {
+    std::size_t start;
+    std::size_t length;
+  };
+
+  static std::string_view trim(std::string_view value) {
+    while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+      value.remove_prefix(1);
+    }
+
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+      value.remove_suffix(1);
+    }
+
+    return value;
+  }
+
+  /* Returns false when the header is malformed and must be ignored. An
+     empty result of a well-formed header means no range is satisfiable. */
+  static bool parse(const std::string_view &header,
+                    const std::size_t &fileSize, std::vector<Slice> &slices) {
+    slices.clear();
+    const std::string_view unit = "bytes=";
+    if (header.substr(0, unit.length()) != unit) return false;
+
+    std::string_view specs = header.substr(unit.length());
+    std::size_t count = 0;
+    while (true) {
+      const std::size_t commaStart = specs.find(',');
+      const std::string_view spec = trim(specs.substr(0, commaStart));
+      if (++count > MAX_RANGES) return false;
+
+      const std::size_t dashStart = spec.find('-');
+      if (dashStart == std::string_view::npos) return false;
+
+      const std::string_view first = spec.substr(0, dashStart);
+      const std::string_view last = spec.substr(dashStart + 1);
+      std::size_t start = 0;
+      std::size_t end = 0;
+      if (first.empty()) {
+        std::size_t suffix = 0;
+        if (!toNumber(last, suffix)) return false;
+        if (suffix && fileSize) {
+          start = fileSize - std::min(suffix, fileSize);
+          slices.push_back({start, fileSize - start});
+        }
+      } else {
+        if (!toNumber(first, start)) return false;
+        end = fileSize ? fileSize - 1 : 0;
+        if (!last.empty()) {
+          if (!toNumber(last, end) || end < start) return false;
+          if (fileSize) end = std::min(end, fileSize - 1);
+        }
+
+        if (start < fileSize) slices.push_back({start, end - start + 1});
+      }
+
+      if (commaStart == std::string_view::npos) break;
+      specs.remove_prefix(commaStart + 1);
+    }
+
+    std::sort(slices.begin(), slices.end(),
+              [](const Slice &a, const Slice &b) { return a.start < b.start; });
+
+    std::size_t merged = 0;
+    for (std::size_t i = 1; i < slices.size(); ++i) {
+      Slice &previous = slices[merged];
+      const std::size_t previousEnd = previous.start + previous.length;
+      if (slices[i].start <= previousEnd) {
+        const std::size_t end = slices[i].start + slices[i].length;
+        previous.length = std::max(previousEnd, end) - previous.start;
+        continue;
+      }
+
+      slices[++merged] = slices[i];
+    }
+
+    if (!slices.empty()) slices.resize(merged + 1);
+    return true;
+  }
+};
+
+#endif
\ No newline at end of file
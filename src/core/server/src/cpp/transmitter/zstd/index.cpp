@@ -0,0 +1,85 @@
+#ifndef ARNELIFY_ZSTD_HPP
+#define ARNELIFY_ZSTD_HPP
+
+/* Defined by the Makefile when pkg-config finds libzstd, which also
+   links it. */
+#ifdef ARNELIFY_HAS_ZSTD
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include <zstd.h>
+
+#include "../contracts/output.hpp"
+
+/* Zstandard stream of a worker. Like the gzip stream, the context is
+   created once per thread and only its session is reset per response. */
+class ArnelifyZstd final {
+ private:
+  std::vector<char> buffer;
+  ZSTD_CCtx *context;
+  ZSTD_outBuffer out;
+
+  ArnelifyZstd() : context(nullptr), out{nullptr, 0, 0} {}
+
+ public:
+  using Output = ArnelifyTransmitterOutput;
+
+  ArnelifyZstd(const ArnelifyZstd &) = delete;
+  ArnelifyZstd &operator=(const ArnelifyZstd &) = delete;
+
+  ~ArnelifyZstd() {
+    if (this->context) ZSTD_freeCCtx(this->context);
+  }
+
+  static ArnelifyZstd &get() {
+    thread_local ArnelifyZstd zstd;
+    return zstd;
+  }
+
+  /* Starts a new frame with output blocks of "blockSize" bytes. */
+  bool begin(int level, const std::size_t &blockSize) {
+    if (!this->context) this->context = ZSTD_createCCtx();
+    if (!this->context) return false;
+
+    level = std::clamp(level, 1, ZSTD_maxCLevel());
+    ZSTD_CCtx_reset(this->context, ZSTD_reset_session_only);
+    const std::size_t ret = ZSTD_CCtx_setParameter(
+        this->context, ZSTD_c_compressionLevel, level);
+    if (ZSTD_isError(ret)) return false;
+
+    this->buffer.resize(std::max<std::size_t>(blockSize, 4096));
+    this->out = {this->buffer.data(), this->buffer.size(), 0};
+    return true;
+  }
+
+  /* Same contract as ArnelifyDeflater::write. */
+  bool write(const char *data, const std::size_t &length,
+             const bool &isFinish, const Output &output) {
+    ZSTD_inBuffer in = {data, length, 0};
+    const ZSTD_EndDirective directive =
+        isFinish ? ZSTD_e_end : ZSTD_e_continue;
+
+    std::size_t remaining = 1;
+    while (in.pos < in.size || (isFinish && remaining)) {
+      if (this->out.pos == this->out.size) {
+        if (!output(this->buffer.data(), this->buffer.size(), false)) {
+          return false;
+        }
+
+        this->out.pos = 0;
+      }
+
+      remaining =
+          ZSTD_compressStream2(this->context, &this->out, &in, directive);
+      if (ZSTD_isError(remaining)) return false;
+    }
+
+    if (!isFinish) return true;
+    return output(this->buffer.data(), this->out.pos, true);
+  }
+};
+
+#endif
+
+#endif
\ No newline at end of file
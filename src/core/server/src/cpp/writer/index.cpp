@@ -0,0 +1,157 @@
+#ifndef ARNELIFY_WRITER_HPP
+#define ARNELIFY_WRITER_HPP
+
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string_view>
+
+#include "json.h"
+
+/* Compact JSON serializer. Produces the same bytes as Json::writeString
+   with an empty indentation and emitUTF8, but appends straight into the
+   caller's buffer: no writer, no ostringstream and no temporary strings
+   are created per response. */
+class ArnelifyWriter final {
+ private:
+  static void writeString(const char *begin, const char *end,
+                          std::string &out) {
+    static constexpr char HEX[] = "0123456789abcdef";
+    out += '"';
+    const char *run = begin;
+    for (const char *c = begin; c != end; ++c) {
+      const unsigned char byte = *c;
+      const bool isEscape = byte < 0x20 || byte == '"' || byte == '\\';
+      if (!isEscape) continue;
+
+      out.append(run, c - run);
+      run = c + 1;
+      switch (byte) {
+        case '"':
+          out += "\\\"";
+          break;
+        case '\\':
+          out += "\\\\";
+          break;
+        case '\b':
+          out += "\\b";
+          break;
+        case '\f':
+          out += "\\f";
+          break;
+        case '\n':
+          out += "\\n";
+          break;
+        case '\r':
+          out += "\\r";
+          break;
+        case '\t':
+          out += "\\t";
+          break;
+        default: {
+          const char escape[] = {'\\', 'u', '0', '0', HEX[byte >> 4],
+                                 HEX[byte & 15]};
+          out.append(escape, sizeof(escape));
+          break;
+        }
+      }
+    }
+
+    out.append(run, end - run);
+    out += '"';
+  }
+
+  /* Doubles keep 17 significant digits and a ".0" when they look like
+     integers, so they read back as doubles. */
+  static void writeReal(const double &value, std::string &out) {
+    if (std::isnan(value)) {
+      out += "null";
+      return;
+    }
+
+    if (std::isinf(value)) {
+      out += value < 0 ? "-1e+9999" : "1e+9999";
+      return;
+    }
+
+    char number[32];
+    const int length = std::snprintf(number, sizeof(number), "%.17g", value);
+    out.append(number, length);
+    const std::string_view digits(number, length);
+    if (digits.find_first_of(".e") == std::string_view::npos) out += ".0";
+  }
+
+ public:
+  static void write(const Json::Value &json, std::string &out) {
+    char number[24];
+    switch (json.type()) {
+      case Json::nullValue:
+        out += "null";
+        break;
+      case Json::intValue: {
+        const auto [ptr, ec] = std::to_chars(number, number + sizeof(number),
+                                             json.asLargestInt());
+        out.append(number, ptr);
+        break;
+      }
+      case Json::uintValue: {
+        const auto [ptr, ec] = std::to_chars(number, number + sizeof(number),
+                                             json.asLargestUInt());
+        out.append(number, ptr);
+        break;
+      }
+      case Json::realValue:
+        writeReal(json.asDouble(), out);
+        break;
+      case Json::stringValue: {
+        const char *begin = nullptr;
+        const char *end = nullptr;
+        if (json.getString(&begin, &end)) writeString(begin, end, out);
+        break;
+      }
+      case Json::booleanValue:
+        out += json.asBool() ? "true" : "false";
+        break;
+      case Json::arrayValue: {
+        out += '[';
+        bool isFirst = true;
+        for (auto it = json.begin(); it != json.end(); ++it) {
+          if (!isFirst) out += ',';
+          isFirst = false;
+          write(*it, out);
+        }
+
+        out += ']';
+        break;
+      }
+      case Json::objectValue: {
+        out += '{';
+        bool isFirst = true;
+        for (auto it = json.begin(); it != json.end(); ++it) {
+          if (!isFirst) out += ',';
+          isFirst = false;
+          const char *end = nullptr;
+          const char *name = it.memberName(&end);
+          writeString(name, end, out);
+          out += ':';
+          write(*it, out);
+        }
+
+        out += '}';
+        break;
+      }
+    }
+  }
+
+  /* Serializes into a buffer kept by the calling thread. The result stays
+     valid until the next call on the same thread. */
+  static const std::string &stringify(const Json::Value &json) {
+    thread_local std::string buffer;
+    buffer.clear();
+    write(json, buffer);
+    return buffer;
+  }
+};
+
+#endif
\ No newline at end of file
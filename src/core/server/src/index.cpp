@@ -21,6 +21,7 @@ class ArnelifyServer {
 
   void (*server_create)(const char *);
   void (*server_destroy)();
+  const char *(*server_get_body)();
   void (*server_set_handler)(const char *(*)(const char *), const int);
   void (*server_start)(void (*)(const char *, const int));
   void (*server_stop)();
@@ -73,14 +74,10 @@ class ArnelifyServer {
 
   ArnelifyServerHandler handler = [](const ArnelifyServerReq &req,
                                      ArnelifyServerRes &res) {
-    Json::StreamWriterBuilder writer;
-    writer["indentation"] = "";
-    writer["emitUTF8"] = true;
-
     Json::Value json;
     json["code"] = 200;
     json["success"] = "Welcome to Arnelify Server";
-    res.addBody(Json::writeString(writer, json));
+    res.addJson(json);
     res.end();
   };
 
@@ -92,6 +89,7 @@ class ArnelifyServer {
 
     loadFunction("server_create", this->server_create);
     loadFunction("server_destroy", this->server_destroy);
+    loadFunction("server_get_body", this->server_get_body);
     loadFunction("server_set_handler", this->server_set_handler);
     loadFunction("server_start", this->server_start);
     loadFunction("server_stop", this->server_stop);
@@ -111,6 +109,21 @@ class ArnelifyServer {
     this->lib = nullptr;
   }
 
+  /* Parses the JSON or urlencoded body of the request being handled,
+     which reaches the handler as the string it was received as. False
+     when its JSON is invalid. Only to be called from the handler. */
+  bool getBody(Json::Value &body) {
+    const char *cBody = this->server_get_body();
+    if (!cBody) return false;
+
+    Json::CharReaderBuilder reader;
+    std::string errors;
+    std::istringstream iss(cBody);
+    Json::parseFromStream(reader, iss, &body, &errors);
+    if (body.isNull()) body = Json::objectValue;
+    return true;
+  }
+
   void setHandler(const ArnelifyServerHandler &handler) {
     stdtoc.setStdHandler(handler);
     this->server_set_handler(StdToC::cHandler, 1);
@@ -0,0 +1,1633 @@
+#ifndef ARNELIFY_SERVER_BENCH_CPP
+#define ARNELIFY_SERVER_BENCH_CPP
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "json.h"
+
+#include "../cpp/ffi.cpp"
+#include "../cpp/index.cpp"
+
+/* Heap allocations of the process, read around a benchmark to report
+   them per response. */
+std::atomic<std::size_t> allocations(0);
+
+void* operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  void* ptr = std::malloc(size ? size : 1);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+/* Request-line and header parser as it was before the incremental one:
+   every step searches the buffer from its start and copies the remainder. */
+class LegacyParser final {
+ private:
+  bool hasHeaders;
+  bool hasMethod;
+  bool hasPath;
+  bool hasVersion;
+
+  std::string buffer;
+  Json::Value req;
+
+  void setCookie(const std::string& value) {
+    bool isFirst = true;
+    std::stringstream ss(value);
+    std::string param;
+    while (std::getline(ss, param, ';')) {
+      const std::size_t equalStart = param.find('=');
+      const bool hasEqual = equalStart != std::string::npos;
+      if (hasEqual) {
+        if (isFirst) {
+          const std::string name = param.substr(0, equalStart);
+          this->req["_state"]["cookie"][name] = param.substr(equalStart + 1);
+          isFirst = false;
+          continue;
+        }
+
+        const std::string name = param.substr(1, equalStart - 1);
+        this->req["_state"]["cookie"][name] = param.substr(equalStart + 1);
+      }
+    }
+  }
+
+  int onMethod() {
+    const std::size_t methodEnd = this->buffer.find(' ');
+    if (methodEnd == std::string::npos) return 0;
+    this->req["_state"]["method"] = this->buffer.substr(0, methodEnd);
+    this->buffer = this->buffer.substr(methodEnd + 1);
+    this->hasMethod = true;
+    return 2;
+  }
+
+  int onPath() {
+    const std::size_t urlEnd = this->buffer.find(' ');
+    if (urlEnd == std::string::npos) return 0;
+    const std::string url = this->buffer.substr(0, urlEnd);
+    this->req["_state"]["path"] = url.substr(0, url.find('?'));
+    this->buffer = this->buffer.substr(urlEnd + 1);
+    this->hasPath = true;
+    return 2;
+  }
+
+  int onVersion() {
+    const std::size_t versionEnd = this->buffer.find("\r\n");
+    if (versionEnd == std::string::npos) return 0;
+    this->req["_state"]["version"] = this->buffer.substr(0, versionEnd);
+    this->buffer = this->buffer.substr(versionEnd + 2);
+    this->hasVersion = true;
+    return 2;
+  }
+
+  int onHeaders() {
+    const std::size_t headersEnd = this->buffer.find("\r\n\r\n");
+    if (headersEnd == std::string::npos) return 0;
+
+    std::string headers = this->buffer.substr(0, headersEnd + 2);
+    std::size_t headerEnd = headers.find("\r\n");
+    while (headerEnd != std::string::npos) {
+      const std::string header = headers.substr(0, headerEnd);
+      const std::size_t colonStart = header.find(": ");
+      if (colonStart != std::string::npos) {
+        const std::string key = header.substr(0, colonStart);
+        const std::string value = header.substr(colonStart + 2);
+        this->req["_state"]["headers"][key] = value;
+        if (key == "Content-Length") std::stoull(value);
+        if (key == "Cookie") this->setCookie(value);
+      }
+
+      headers = headers.substr(headerEnd + 2);
+      headerEnd = headers.find("\r\n");
+    }
+
+    this->buffer = this->buffer.substr(headersEnd + 4);
+    this->hasHeaders = true;
+    return 2;
+  }
+
+ public:
+  LegacyParser()
+      : hasHeaders(false),
+        hasMethod(false),
+        hasPath(false),
+        hasVersion(false) {}
+
+  int onBlock(const char* block, const std::size_t& bytesRead) {
+    this->buffer.append(block, bytesRead);
+    if (!this->hasMethod && this->onMethod() != 2) return 0;
+    if (!this->hasPath && this->onPath() != 2) return 0;
+    if (!this->hasVersion && this->onVersion() != 2) return 0;
+    if (!this->hasHeaders && this->onHeaders() != 2) return 0;
+    return 2;
+  }
+
+  const Json::Value finish() {
+    const Json::Value req = std::move(this->req);
+    this->req = Json::Value();
+    this->buffer.clear();
+    this->hasHeaders = false;
+    this->hasMethod = false;
+    this->hasPath = false;
+    this->hasVersion = false;
+    return req;
+  }
+};
+
+/* Query strings as they were parsed before the table-driven decoder: the
+   whole string is decoded with sscanf per escape, split through a
+   stringstream, and every name is cut into copied keys. */
+class LegacyQuery final {
+ public:
+  static void decode(const std::string& encoded, std::string& decoded) {
+    int hex;
+    for (std::size_t i = 0; i < encoded.length(); ++i) {
+      if (encoded[i] == '%') {
+        if (i + 2 < encoded.length() &&
+            sscanf(encoded.substr(i + 1, 2).c_str(), "%x", &hex) == 1) {
+          decoded += static_cast<char>(hex);
+          i += 2;
+        }
+
+        continue;
+      }
+
+      decoded += encoded[i] == '+' ? ' ' : encoded[i];
+    }
+  }
+
+  static std::vector<std::string> getKeys(const std::string& name) {
+    const std::size_t patternStart = name.find("[]");
+    if (patternStart == std::string::npos) return {name};
+
+    std::vector<std::string> keys;
+    std::string buffer = name.substr(0, patternStart);
+    std::size_t keyStart = buffer.find("[");
+    if (keyStart == std::string::npos) return {buffer};
+
+    keys.emplace_back(buffer.substr(0, keyStart));
+    buffer = buffer.substr(keyStart);
+    keyStart = buffer.find("[");
+    while (keyStart != std::string::npos) {
+      const std::size_t keyEnd = buffer.find("]", keyStart + 1);
+      if (keyEnd == std::string::npos) return {name};
+
+      const std::string key =
+          buffer.substr(keyStart + 1, keyEnd - keyStart - 1);
+      if (key.find("[") != std::string::npos) return {name};
+
+      keys.emplace_back(key);
+      keyStart = buffer.find("[", keyEnd + 1);
+    }
+
+    return keys;
+  }
+
+  static void append(Json::Value& root, const std::string& name,
+                     const Json::Value& value) {
+    Json::Value* current = &root;
+    for (const std::string& key : getKeys(name)) {
+      if (current->isArray()) return;
+      current = &(*current)[key];
+    }
+
+    if (!current->isArray()) *current = Json::arrayValue;
+    current->append(value);
+  }
+
+  static Json::Value parse(const std::string& query) {
+    Json::Value root;
+    std::string decoded;
+    decode(query, decoded);
+    std::stringstream ss(decoded);
+    std::string pair;
+    while (std::getline(ss, pair, '&')) {
+      const std::size_t equalStart = pair.find("=");
+      append(root, pair.substr(0, equalStart), pair.substr(equalStart + 1));
+    }
+
+    return root;
+  }
+};
+
+template <typename Parser>
+double bench(Parser& parser, const std::string& request,
+             const std::size_t& blockSize, const int& iterations) {
+  std::size_t checksum = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    int SIGNAL = 0;
+    for (std::size_t j = 0; j < request.length() && !SIGNAL; j += blockSize) {
+      const std::size_t bytesRead = std::min(blockSize, request.length() - j);
+      SIGNAL = parser.onBlock(request.data() + j, bytesRead);
+    }
+
+    if (SIGNAL != 2) {
+      std::cout << "Parser failed at iteration " << i << std::endl;
+      exit(1);
+    }
+
+    checksum += parser.finish()["_state"]["headers"].size();
+  }
+
+  const auto end = std::chrono::steady_clock::now();
+  if (!checksum) exit(1);
+
+  const std::chrono::duration<double> elapsed = end - start;
+  return iterations / elapsed.count();
+}
+
+std::string makeHead() {
+  std::string request = "GET /api/v1/users/42?fields=name HTTP/1.1\r\n";
+  request += "Host: localhost:3001\r\n";
+  request += "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0)\r\n";
+  request += "Accept: text/html,application/xhtml+xml,application/xml\r\n";
+  request += "Accept-Language: en-US,en;q=0.5\r\n";
+  request += "Accept-Encoding: gzip, deflate, br\r\n";
+  request += "Cookie: session=4f2a9c; theme=dark; lang=en\r\n";
+  request += "Connection: keep-alive\r\n";
+  request += "Content-Length: 0\r\n";
+  for (int i = 0; i < 8; ++i) {
+    request += "X-Trace-" + std::to_string(i) + ": ";
+    request += std::string(48, 'a' + i) + "\r\n";
+  }
+
+  request += "\r\n";
+  return request;
+}
+
+void benchHead(const int& iterations) {
+  const std::string request = makeHead();
+  ArnelifyReceiverOpts opts(true, "127.0.0.1", true, 1024, 20, 1, 60, 60);
+  for (const std::size_t blockSize : {request.length(), std::size_t(64),
+                                      std::size_t(16), std::size_t(1)}) {
+    const int rounds = blockSize == 1 ? iterations / 10 : iterations;
+    LegacyParser legacy;
+    ArnelifyReceiver receiver(opts);
+    const double legacyRate = bench(legacy, request, blockSize, rounds);
+    const double receiverRate = bench(receiver, request, blockSize, rounds);
+
+    std::cout << "head, block " << blockSize << " B: legacy " << legacyRate
+              << " req/s, incremental " << receiverRate << " req/s, x"
+              << receiverRate / legacyRate << std::endl;
+  }
+}
+
+template <typename Find>
+void benchFind(const std::string& label, const std::string& haystack,
+               const std::string& needle, Find find) {
+  const std::size_t expected = haystack.find(needle);
+  const std::size_t rounds = (std::size_t(1) << 32) / haystack.length();
+  const auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < rounds; ++i) {
+    asm volatile("" ::: "memory");
+    if (find(haystack, needle) != expected) {
+      std::cout << label << " returned a wrong index" << std::endl;
+      exit(1);
+    }
+  }
+
+  const auto end = std::chrono::steady_clock::now();
+  const std::chrono::duration<double> elapsed = end - start;
+  const double bytes = static_cast<double>(haystack.length()) * rounds;
+  std::cout << "  " << label << ": " << bytes / elapsed.count() / 1e9
+            << " GB/s" << std::endl;
+}
+
+void benchScanner(const std::string& label, const std::string& haystack,
+                  const std::string& needle) {
+  std::cout << "scan " << label << ", " << haystack.length() / 1024
+            << " KB" << std::endl;
+  benchFind("std::string::find", haystack, needle,
+            [](const std::string& h, const std::string& n) {
+              return h.find(n);
+            });
+  benchFind("scalar", haystack, needle,
+            [](const std::string& h, const std::string& n) {
+              return ArnelifyScanner::findScalar(h.data(), h.length(),
+                                                 n.data(), n.length());
+            });
+  benchFind("dispatched", haystack, needle,
+            [](const std::string& h, const std::string& n) {
+              return ArnelifyScanner::find(h, n);
+            });
+#ifdef ARNELIFY_SCANNER_X86
+  if (__builtin_cpu_supports("avx2")) {
+    benchFind("avx2", haystack, needle,
+              [](const std::string& h, const std::string& n) {
+                return ArnelifyScanner::findAvx2(h.data(), h.length(),
+                                                 n.data(), n.length());
+              });
+  }
+#endif
+}
+
+/* Every kernel must agree with std::string_view::find, including needles
+   that straddle the vector width and matches near the end of the input. */
+void checkScanner(std::mt19937& rng) {
+  const std::string alphabet = "-\r\nab";
+  for (int i = 0; i < 20000; ++i) {
+    std::string haystack(rng() % 200, 'a');
+    for (char& c : haystack) c = alphabet[rng() % alphabet.length()];
+    std::string needle(1 + rng() % 6, 'a');
+    for (char& c : needle) c = alphabet[rng() % alphabet.length()];
+
+    const std::size_t from = rng() % (haystack.length() + 2);
+    const std::size_t expected = std::string_view(haystack).find(needle, from);
+    const std::size_t index = ArnelifyScanner::find(haystack, needle, from);
+    const std::size_t scalar = ArnelifyScanner::findScalar(
+        haystack.data(), haystack.length(), needle.data(), needle.length());
+    bool isValid = index == expected && scalar == haystack.find(needle);
+#ifdef ARNELIFY_SCANNER_X86
+    if (__builtin_cpu_supports("avx2")) {
+      isValid = isValid && scalar == ArnelifyScanner::findAvx2(
+                                         haystack.data(), haystack.length(),
+                                         needle.data(), needle.length());
+    }
+#endif
+    if (!isValid) {
+      std::cout << "Scanner mismatch for needle of " << needle.length()
+                << " bytes" << std::endl;
+      exit(1);
+    }
+  }
+}
+
+/* Random documents, including control characters, bytes above 0x7f and
+   non-finite doubles, must come out as Json::writeString writes them. */
+Json::Value makeValue(std::mt19937& rng, const int& depth) {
+  const double reals[] = {0.1, 1.0, -0.0, 1e300, 2.5e-10, 123456789.0, NAN,
+                          INFINITY, -INFINITY};
+  std::string text(rng() % 12, 'a');
+  for (char& c : text) c = static_cast<char>(rng());
+
+  Json::Value json;
+  switch (rng() % (depth > 3 ? 6 : 8)) {
+    case 0:
+      return json;
+    case 1:
+      return Json::Int64(static_cast<int64_t>(rng()) * rng() - rng());
+    case 2:
+      return Json::UInt64(rng()) * rng() * 7;
+    case 3:
+      return reals[rng() % std::size(reals)];
+    case 4:
+      return text;
+    case 5:
+      return rng() % 2 == 0;
+    case 6:
+      json = Json::arrayValue;
+      for (int i = rng() % 5; i > 0; --i) {
+        json.append(makeValue(rng, depth + 1));
+      }
+
+      return json;
+    default:
+      json = Json::objectValue;
+      for (int i = rng() % 5; i > 0; --i) {
+        text.resize(rng() % 5);
+        json[text] = makeValue(rng, depth + 1);
+      }
+
+      return json;
+  }
+}
+
+void checkWriter(std::mt19937& rng) {
+  Json::StreamWriterBuilder writer;
+  writer["indentation"] = "";
+  writer["emitUTF8"] = true;
+
+  for (int i = 0; i < 20000; ++i) {
+    const Json::Value json = makeValue(rng, 0);
+    std::string body;
+    ArnelifyWriter::write(json, body);
+    if (body != Json::writeString(writer, json)) {
+      std::cout << "Writer mismatch: " << body << std::endl;
+      exit(1);
+    }
+  }
+}
+
+/* Range headers resolved against a 1000-byte file. */
+void checkRange() {
+  struct Case {
+    const char* header;
+    bool isValid;
+    std::string slices;
+  };
+
+  const Case cases[] = {{"bytes=0-99", true, "0+100"},
+                        {"bytes=900-", true, "900+100"},
+                        {"bytes=-50", true, "950+50"},
+                        {"bytes=-5000", true, "0+1000"},
+                        {"bytes=990-2000", true, "990+10"},
+                        {"bytes=0-9, 5-19,20-29", true, "0+30"},
+                        {"bytes=50-59,0-9", true, "0+10 50+10"},
+                        {"bytes=1000-", true, ""},
+                        {"bytes=-0", true, ""},
+                        {"bytes=9-0", false, ""},
+                        {"bytes=a-b", false, ""},
+                        {"bytes=1", false, ""},
+                        {"items=0-9", false, ""}};
+
+  for (const Case& test : cases) {
+    std::vector<ArnelifyRange::Slice> slices;
+    const bool isValid = ArnelifyRange::parse(test.header, 1000, slices);
+    std::string result;
+    for (const ArnelifyRange::Slice& slice : slices) {
+      if (!result.empty()) result += " ";
+      result += std::to_string(slice.start) + "+" +
+                std::to_string(slice.length);
+    }
+
+    if (isValid != test.isValid || result != test.slices) {
+      std::cout << "Range mismatch for " << test.header << ": " << result
+                << std::endl;
+      exit(1);
+    }
+  }
+}
+
+/* Accept-Encoding headers resolved for a large and a small response. */
+void checkEncoding() {
+  struct Case {
+    const char* header;
+    std::size_t length;
+    std::string codings;
+  };
+
+  const Case cases[] = {{"gzip, deflate, br, zstd", 65536, "br zstd gzip"},
+                        {"gzip, deflate, br, zstd", 512, "gzip zstd br"},
+                        {"gzip;q=1, br;q=0.5", 65536, "gzip br"},
+                        {"br;q=0, gzip", 65536, "gzip"},
+                        {"BR;Q=0.9, x-gzip;q=0.8", 65536, "br gzip"},
+                        {"*;q=0.5, gzip", 65536, "gzip br zstd"},
+                        {"*, br;q=0", 65536, "zstd gzip"},
+                        {"gzip;q=2, br;q=abc, zstd", 65536, "zstd"},
+                        {"gzip; level=1; q=0.3", 65536, "gzip"},
+                        {"identity", 65536, ""},
+                        {"", 65536, ""}};
+
+  for (const Case& test : cases) {
+    std::string result;
+    for (const std::string_view& coding :
+         ArnelifyEncoding::negotiate(test.header, test.length)) {
+      if (!result.empty()) result += " ";
+      result += coding;
+    }
+
+    if (result != test.codings) {
+      std::cout << "Encoding mismatch for " << test.header << ": " << result
+                << std::endl;
+      exit(1);
+    }
+  }
+}
+
+/* Parts whose content is full of near-boundaries must come out intact no
+   matter where the blocks are cut. */
+void checkMultipart(std::mt19937& rng) {
+  const std::string boundary = "--xYz";
+  const std::vector<std::string> pieces = {"\r", "\n", "-", "\r\n-",
+                                           "\r\n--xY", "\r\n--x", "a"};
+  const std::filesystem::path uploadDir =
+      std::filesystem::temp_directory_path() / "arnelify-check";
+  std::filesystem::create_directories(uploadDir);
+  ArnelifyReceiverOpts opts(true, "127.0.0.1", true, 1024, 20, 1, 60, 60,
+                            uploadDir.string());
+
+  for (int i = 0; i < 2000; ++i) {
+    std::string field;
+    std::string file;
+    for (int j = rng() % 12; j > 0; --j) field += pieces[rng() % 7];
+    for (int j = rng() % 40; j > 0; --j) file += pieces[rng() % 7];
+
+    std::string body = "preamble\r\n--" + boundary + "\r\n";
+    body += "Content-Disposition: form-data; name=\"f\"\r\n\r\n";
+    body += field + "\r\n--" + boundary + "\r\n";
+    body += "Content-Disposition: form-data; name=\"a\"; ";
+    body += "filename=\"a.bin\"\r\n\r\n";
+    body += file + "\r\n--" + boundary + "--\r\n";
+
+    std::string request = "POST / HTTP/1.1\r\n";
+    request += "Content-Type: multipart/form-data; boundary=" + boundary;
+    request += "\r\nContent-Length: " + std::to_string(body.length());
+    request += "\r\n\r\n" + body;
+
+    ArnelifyReceiver receiver(opts);
+    int SIGNAL = 0;
+    for (std::size_t j = 0; j < request.length() && !SIGNAL;) {
+      const std::size_t bytesRead =
+          std::min<std::size_t>(1 + rng() % 24, request.length() - j);
+      SIGNAL = receiver.onBlock(request.data() + j, bytesRead);
+      j += bytesRead;
+    }
+
+    const ArnelifyServerReq& req = receiver.finish();
+    bool isValid = SIGNAL == 2 && req["body"]["f"][0].asString() == field;
+    if (isValid && !file.empty()) {
+      const std::string path = req["files"]["a"][0]["path"].asString();
+      std::ifstream saved(path, std::ios::binary);
+      const std::string content((std::istreambuf_iterator<char>(saved)),
+                                std::istreambuf_iterator<char>());
+      isValid = content == file;
+    }
+
+    if (!isValid) {
+      std::cout << "Multipart mismatch at iteration " << i << std::endl;
+      exit(1);
+    }
+  }
+
+  std::filesystem::remove_all(uploadDir);
+}
+
+void benchMultipart(std::mt19937& rng, const std::size_t& fileSize) {
+  const std::string boundary = "----WebKitFormBoundary7MA4YWxkTrZu0gW";
+  std::string file(fileSize, 0);
+  for (char& c : file) c = static_cast<char>(rng());
+
+  std::string body = "--" + boundary + "\r\n";
+  body += "Content-Disposition: form-data; name=\"file\"; ";
+  body += "filename=\"bench.bin\"\r\n";
+  body += "Content-Type: application/octet-stream\r\n\r\n";
+  body += file + "\r\n--" + boundary + "--\r\n";
+
+  std::string request = "POST /upload HTTP/1.1\r\n";
+  request += "Content-Type: multipart/form-data; boundary=" + boundary;
+  request += "\r\nContent-Length: " + std::to_string(body.length());
+  request += "\r\n\r\n" + body;
+
+  const std::filesystem::path uploadDir =
+      std::filesystem::temp_directory_path() / "arnelify-bench";
+  std::filesystem::create_directories(uploadDir);
+
+  struct Sink {
+    const char* label;
+    std::size_t bufferKb;
+    bool isDirect;
+    bool isPreallocate;
+  };
+
+  for (const std::size_t blockSize : {1024, 64 * 1024}) {
+    for (const Sink& sink : {Sink{"unbuffered", 0, false, false},
+                             Sink{"coalesced", 1024, false, true},
+                             Sink{"direct", 1024, true, true}}) {
+      ArnelifyReceiverOpts opts(true, "127.0.0.1", true, 1024, 20, 1, 4096,
+                                4096, uploadDir.string(), sink.bufferKb,
+                                sink.isDirect, sink.isPreallocate);
+      ArnelifyReceiver receiver(opts);
+
+      const auto start = std::chrono::steady_clock::now();
+      int SIGNAL = 0;
+      for (std::size_t j = 0; j < request.length() && !SIGNAL; j += blockSize) {
+        const std::size_t bytesRead = std::min(blockSize, request.length() - j);
+        SIGNAL = receiver.onBlock(request.data() + j, bytesRead);
+      }
+
+      const auto end = std::chrono::steady_clock::now();
+      const ArnelifyServerReq& req = receiver.finish();
+      const std::string path = req["files"]["file"][0]["path"].asString();
+      std::ifstream saved(path, std::ios::binary);
+      const std::string content((std::istreambuf_iterator<char>(saved)),
+                                std::istreambuf_iterator<char>());
+      std::filesystem::remove(path);
+      if (SIGNAL != 2 || content != file) {
+        std::cout << "Multipart upload failed: " << receiver.getStatus()
+                  << std::endl;
+        exit(1);
+      }
+
+      const std::chrono::duration<double> elapsed = end - start;
+      std::cout << "multipart upload, " << fileSize / 1048576 << " MB in "
+                << blockSize / 1024 << " KB blocks, " << sink.label << ": "
+                << request.length() / elapsed.count() / 1e9 << " GB/s, disk "
+                << req["_state"]["upload"]["mbps"].asDouble() << " MB/s"
+                << std::endl;
+    }
+  }
+
+  std::filesystem::remove_all(uploadDir);
+}
+
+/* Gzip of one response body: a stream set up and torn down per response,
+   as before, against the pooled stream of the worker. */
+void benchGzip(const std::string& label, const std::string& body,
+               const int& iterations) {
+  std::vector<char> out(body.length() + 1024);
+  for (const bool isPooled : {false, true}) {
+    std::size_t bytesCompressed = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      if (isPooled) {
+        ArnelifyDeflater& deflater = ArnelifyDeflater::get();
+        deflater.begin(6, 65536);
+        deflater.write(body.data(), body.length(), true,
+                       [&](const char*, std::size_t length, bool) {
+                         bytesCompressed += length;
+                         return true;
+                       });
+        continue;
+      }
+
+      z_stream zlib{};
+      deflateInit2(&zlib, 6, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+      zlib.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(body.data()));
+      zlib.avail_in = body.length();
+      zlib.next_out = reinterpret_cast<Bytef*>(out.data());
+      zlib.avail_out = out.size();
+      deflate(&zlib, Z_FINISH);
+      bytesCompressed += out.size() - zlib.avail_out;
+      deflateEnd(&zlib);
+    }
+
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << "gzip, " << label << ", "
+              << (isPooled ? "pooled stream" : "stream per response") << ": "
+              << elapsed.count() / iterations * 1e6 << " us/response, "
+              << bytesCompressed / iterations << " bytes" << std::endl;
+  }
+}
+/* A handler reading a few fields of a request, through the typed
+   accessors and through the Json::Value tree built on demand. */
+void benchRequest(const int& iterations) {
+  const std::string request = makeHead();
+  ArnelifyReceiverOpts opts(true, "127.0.0.1", true, 1024, 20, 1, 60, 60);
+  ArnelifyReceiver receiver(opts);
+  std::size_t typedChecksum = 0;
+  for (const bool isTyped : {true, false}) {
+    std::size_t checksum = 0;
+    const std::size_t allocationsStart = allocations.load();
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      receiver.onBlock(request.data(), request.length());
+      const ArnelifyServerReq& req = receiver.finish();
+      if (isTyped) {
+        checksum += req.getMethod().length() + req.getPath().length() +
+                    req.getHeader("Host").length() +
+                    req.getCookie("session").length() +
+                    req.getQuery("fields").length();
+        continue;
+      }
+
+      checksum += req["_state"]["method"].asString().length() +
+                  req["_state"]["path"].asString().length() +
+                  req["_state"]["headers"]["Host"].asString().length() +
+                  req["_state"]["cookie"]["session"].asString().length() +
+                  req["query"]["fields"][0].asString().length();
+    }
+
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    const double allocationsTotal = allocations.load() - allocationsStart;
+    if (isTyped) typedChecksum = checksum;
+    if (!checksum || checksum != typedChecksum) {
+      std::cout << "Request fields mismatch" << std::endl;
+      exit(1);
+    }
+
+    std::cout << "request, " << (isTyped ? "typed" : "json") << ": "
+              << elapsed.count() / iterations * 1e6 << " us/request, "
+              << allocationsTotal / iterations << " allocations/request"
+              << std::endl;
+  }
+}
+
+/* Percent-encodes every byte but letters and digits, with "+" for a
+   space and hex digits of either case. */
+std::string encode(std::mt19937& rng, const std::string& text) {
+  const char* digits[] = {"0123456789ABCDEF", "0123456789abcdef"};
+  std::string encoded;
+  for (const char c : text) {
+    const unsigned char byte = c;
+    if (std::isalnum(byte)) {
+      encoded += c;
+      continue;
+    }
+
+    if (c == ' ') {
+      encoded += '+';
+      continue;
+    }
+
+    const char* hex = digits[rng() % 2];
+    encoded += '%';
+    encoded += hex[byte >> 4];
+    encoded += hex[byte & 15];
+  }
+
+  return encoded;
+}
+
+/* The decoding rules spelled out: "+" is a space, "%" followed by two hex
+   digits is that byte and any other "%" is dropped. */
+std::string decodeReference(const std::string_view& encoded) {
+  std::string decoded;
+  for (std::size_t i = 0; i < encoded.length(); ++i) {
+    if (encoded[i] == '+') {
+      decoded += ' ';
+      continue;
+    }
+
+    if (encoded[i] != '%') {
+      decoded += encoded[i];
+      continue;
+    }
+
+    const bool isEscape = i + 2 < encoded.length() &&
+                          std::isxdigit(static_cast<unsigned char>(
+                              encoded[i + 1])) &&
+                          std::isxdigit(static_cast<unsigned char>(
+                              encoded[i + 2]));
+    if (!isEscape) continue;
+
+    decoded += static_cast<char>(
+        std::stoi(std::string(encoded.substr(i + 1, 2)), nullptr, 16));
+    i += 2;
+  }
+
+  return decoded;
+}
+
+Json::Value parseReference(const std::string_view& query) {
+  Json::Value root;
+  std::size_t pairStart = 0;
+  while (pairStart < query.length()) {
+    std::size_t pairEnd = query.find('&', pairStart);
+    if (pairEnd == std::string_view::npos) pairEnd = query.length();
+
+    const std::string_view pair = query.substr(pairStart, pairEnd - pairStart);
+    const std::size_t equalStart = pair.find('=');
+    const std::string name = decodeReference(pair.substr(0, equalStart));
+    const bool hasEqual = equalStart != std::string_view::npos;
+    const std::string value =
+        hasEqual ? decodeReference(pair.substr(equalStart + 1)) : name;
+    LegacyQuery::append(root, name, value);
+    pairStart = pairEnd + 1;
+  }
+
+  return root;
+}
+
+/* Arbitrary bytes survive encoding into the URL, and junk query strings
+   made of delimiters, brackets and broken escapes give the same tree as
+   the rules above with the former key splitting. */
+void checkQuery(std::mt19937& rng) {
+  ArnelifyReceiverOpts opts(true, "127.0.0.1", true, 1024, 20, 1, 60, 60);
+  ArnelifyReceiver receiver(opts);
+  const std::string names[] = {"q", "a[b][]", "x y", "caf\xc3\xa9", "%"};
+  for (int i = 0; i < 5000; ++i) {
+    std::string value(rng() % 40, '\0');
+    for (char& c : value) c = static_cast<char>(rng());
+    const std::string& name = names[rng() % 5];
+    const std::string request = "GET /s?" + encode(rng, name) + "=" +
+                                encode(rng, value) + "&z=1 HTTP/1.1\r\n\r\n";
+    if (receiver.onBlock(request.data(), request.length()) != 2) {
+      std::cout << "Query not received: " << request << std::endl;
+      exit(1);
+    }
+
+    const ArnelifyServerReq& req = receiver.finish();
+    if (req.getQuery(name) != value || req.getQuery("z") != "1") {
+      std::cout << "Query mismatch: " << request << std::endl;
+      exit(1);
+    }
+  }
+
+  const char alphabet[] = "%%%++&&==[[]]abAF09";
+  for (int i = 0; i < 20000; ++i) {
+    std::string query(rng() % 24, '\0');
+    for (char& c : query) {
+      const bool isByte = rng() % 16 == 0;
+      c = isByte ? static_cast<char>(rng())
+                 : alphabet[rng() % (sizeof(alphabet) - 1)];
+    }
+
+    std::string request = "POST /s HTTP/1.1\r\nContent-Type: ";
+    request += "application/x-www-form-urlencoded\r\nContent-Length: ";
+    request += std::to_string(query.length()) + "\r\n\r\n" + query;
+    if (receiver.onBlock(request.data(), request.length()) != 2) {
+      std::cout << "Body not received: " << query << std::endl;
+      exit(1);
+    }
+
+    const ArnelifyServerReq& req = receiver.finish();
+    const std::string body = ArnelifyWriter::stringify(req.getBody());
+    const std::string expected =
+        ArnelifyWriter::stringify(parseReference(query));
+    if (body != expected) {
+      std::cout << "Query mismatch for " << query << ": " << body << " vs "
+                << expected << std::endl;
+      exit(1);
+    }
+  }
+}
+
+/* An urlencoded form of search filters, pagination and tracking fields,
+   most of them nested, parsed into its tree, and the same fields in the
+   URL read as spans. */
+void benchQuery(const int& iterations) {
+  std::string query = "q=red+running+shoes%2C+size+42&sort=-created_at";
+  query += "&page[number]=3&page[size]=50";
+  for (const char* status : {"active", "pending", "back%20order"}) {
+    query += "&filter[status][]=";
+    query += status;
+  }
+
+  for (int i = 0; i < 16; ++i) {
+    query += "&filter[ids][]=" + std::to_string(1000 + i * 37);
+  }
+
+  for (const char* tag : {"caf%C3%A9", "sale%21", "new+in", "50%25+off"}) {
+    query += "&filter[tags][]=";
+    query += tag;
+  }
+
+  query += "&user[address][city][]=M%C3%BCnchen&user[address][zip][]=80331";
+  query += "&utm_source=newsletter&utm_medium=email&utm_campaign=spring";
+  query += "&ref=https%3A%2F%2Fexample.com%2Fdeals%3Fid%3D7";
+
+  std::string request = "POST /search HTTP/1.1\r\nContent-Type: ";
+  request += "application/x-www-form-urlencoded\r\nContent-Length: ";
+  request += std::to_string(query.length()) + "\r\n\r\n" + query;
+
+  const std::string url = "GET /search?" + query + " HTTP/1.1\r\n\r\n";
+
+  ArnelifyReceiverOpts opts(true, "127.0.0.1", true, 1024, 20, 1, 60, 60);
+  ArnelifyReceiver receiver(opts);
+  std::string legacyJson;
+  for (const char* mode : {"legacy", "table-driven", "spans"}) {
+    const std::string_view label = mode;
+    const bool isLegacy = label == "legacy";
+    if (label == "spans") {
+      std::size_t checksum = 0;
+      const std::size_t allocationsStart = allocations.load();
+      const auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < iterations; ++i) {
+        receiver.onBlock(url.data(), url.length());
+        const ArnelifyServerReq& req = receiver.finish();
+        checksum += req.getQuery("q").length() + req.getQuery("ref").length();
+      }
+
+      const std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      const double allocationsTotal = allocations.load() - allocationsStart;
+      if (!checksum) exit(1);
+      std::cout << "query, " << query.length() << " B in URL, spans: "
+                << elapsed.count() / iterations * 1e6 << " us/request, "
+                << allocationsTotal / iterations << " allocations/request"
+                << std::endl;
+      continue;
+    }
+
+    std::string json;
+    const std::size_t allocationsStart = allocations.load();
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      receiver.onBlock(request.data(), request.length());
+      const ArnelifyServerReq& req = receiver.finish();
+      if (isLegacy) {
+        const Json::Value body =
+            LegacyQuery::parse(std::string(req.getRawBody()));
+        if (!i) json = ArnelifyWriter::stringify(body);
+        continue;
+      }
+
+      if (!i) json = ArnelifyWriter::stringify(req.getBody());
+      if (!req.getBody().isObject()) exit(1);
+    }
+
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    const double allocationsTotal = allocations.load() - allocationsStart;
+    if (isLegacy) legacyJson = json;
+    if (json != legacyJson) {
+      std::cout << "Query tree mismatch: " << json << std::endl;
+      exit(1);
+    }
+
+    std::cout << "query, " << query.length() << " B form, "
+              << label << ": "
+              << elapsed.count() / iterations * 1e6 << " us/request, "
+              << allocationsTotal / iterations << " allocations/request"
+              << std::endl;
+  }
+}
+
+/* A multipart form with "names" distinct fields, each sent twice as an
+   array. */
+std::string makeForm(const int& names) {
+  const std::string boundary = "xYz";
+  std::string body;
+  for (int i = 0; i < names * 2; ++i) {
+    body += "--" + boundary + "\r\nContent-Disposition: form-data; ";
+    body += "name=\"field_" + std::to_string(i % names) + "[]\"\r\n\r\n";
+    body += "value\r\n";
+  }
+
+  body += "--" + boundary + "--\r\n";
+  std::string request = "POST / HTTP/1.1\r\n";
+  request += "Content-Type: multipart/form-data; boundary=" + boundary;
+  request += "\r\nContent-Length: " + std::to_string(body.length());
+  request += "\r\n\r\n" + body;
+  return request;
+}
+
+/* Forms are limited by their distinct names, however often each repeats
+   and on either side of the small-vector spill. */
+void checkFields() {
+  ArnelifyReceiverOpts opts(true, "127.0.0.1", true, 1024, 20, 1, 60, 60);
+  for (const int names : {1, 16, 17, 1024, 1025}) {
+    ArnelifyReceiver receiver(opts);
+    const std::string request = makeForm(names);
+    const int SIGNAL = receiver.onBlock(request.data(), request.length());
+    const ArnelifyServerReq& req = receiver.finish();
+    const bool isAccepted = names <= 1024;
+    const bool isValid = isAccepted ? SIGNAL == 2 &&
+                                          req.getBody().size() == names &&
+                                          req.getBody()["field_0"].size() == 2
+                                    : SIGNAL == 1;
+    if (!isValid) {
+      std::cout << "Fields mismatch for " << names << " names" << std::endl;
+      exit(1);
+    }
+  }
+}
+
+/* Registering the names of a form as the receiver does, against the
+   former linear search, from tiny forms to SERVER_MAX_FIELDS. */
+void benchFields(const int& iterations) {
+  for (const int names : {4, 16, 64, 256, 1024}) {
+    std::vector<std::string> keys;
+    for (int i = 0; i < names * 2; ++i) {
+      keys.emplace_back("field_" + std::to_string(i % names));
+    }
+
+    const int rounds = std::max(1, iterations / names);
+    ArnelifyFields fields;
+    std::vector<std::string> legacy;
+    std::size_t checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i) {
+      legacy.clear();
+      for (const std::string& key : keys) {
+        const bool hasKey =
+            std::find(legacy.begin(), legacy.end(), key) != legacy.end();
+        if (!hasKey) legacy.emplace_back(key);
+      }
+
+      checksum += legacy.size();
+    }
+
+    const auto middle = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i) {
+      fields.clear();
+      for (const std::string& key : keys) fields.insert(key);
+      checksum -= fields.size();
+    }
+
+    const auto end = std::chrono::steady_clock::now();
+    if (checksum) {
+      std::cout << "Fields count mismatch" << std::endl;
+      exit(1);
+    }
+
+    const std::chrono::duration<double> legacyTime = middle - start;
+    const std::chrono::duration<double> fieldsTime = end - middle;
+    std::cout << "fields, " << names << " names: linear "
+              << legacyTime.count() / rounds * 1e6 << " us/form, registry "
+              << fieldsTime.count() / rounds * 1e6 << " us/form, x"
+              << legacyTime.count() / fieldsTime.count() << std::endl;
+  }
+}
+
+/* Bodies are kept raw until they are read, and parse as they did when
+   the receiver parsed them up front. */
+void checkBody() {
+  struct Case {
+    const char* type;
+    std::string body;
+    bool isValid;
+    std::string json;
+  };
+
+  const Case cases[] = {
+      {"application/json", "{\"id\":42,\"tags\":[\"a\",\"b\"]}", true,
+       "{\"id\":42,\"tags\":[\"a\",\"b\"]}"},
+      {"application/json", "{\"id\":", false, "null"},
+      {"application/json", "", false, "null"},
+      {"application/x-www-form-urlencoded", "a=1&b[]=2&b[]=x%20y", true,
+       "{\"a\":[\"1\"],\"b\":[\"2\",\"x y\"]}"},
+      {"text/plain", "name=value", true, "{\"name\":[\"value\"]}"}};
+
+  ArnelifyReceiverOpts opts(true, "127.0.0.1", true, 1024, 20, 1, 60, 60);
+  ArnelifyReceiver receiver(opts);
+  for (const Case& test : cases) {
+    std::string request = "POST /users HTTP/1.1\r\nContent-Type: ";
+    request += test.type;
+    request += "\r\nContent-Length: " + std::to_string(test.body.length());
+    request += "\r\n\r\n" + test.body;
+    if (receiver.onBlock(request.data(), request.length()) != 2) {
+      std::cout << "Body not received for " << test.body << std::endl;
+      exit(1);
+    }
+
+    const ArnelifyServerReq& req = receiver.finish();
+    const bool isRaw = req.getRawBody() == test.body &&
+                       req.toJson(true)["body"].asString() == test.body;
+    const std::string json = ArnelifyWriter::stringify(req.getBody());
+    if (!isRaw || req.isValidBody() != test.isValid || json != test.json) {
+      std::cout << "Body mismatch for " << test.body << ": " << json
+                << std::endl;
+      exit(1);
+    }
+  }
+}
+
+/* A request with a JSON body that is turned away without reading it,
+   against one whose body is read and the former up-front parse. */
+void benchBody(const int& iterations) {
+  Json::Value items = Json::arrayValue;
+  for (int i = 0; i < 64; ++i) {
+    Json::Value item;
+    item["id"] = i;
+    item["name"] = "item " + std::to_string(i);
+    item["tags"].append("a");
+    item["tags"].append("b");
+    items.append(item);
+  }
+
+  const std::string body = ArnelifyWriter::stringify(items);
+  std::string request = "POST /missing HTTP/1.1\r\n";
+  request += "Content-Type: application/json\r\n";
+  request += "Content-Length: " + std::to_string(body.length()) + "\r\n\r\n";
+  request += body;
+
+  ArnelifyReceiverOpts opts(true, "127.0.0.1", true, 1024, 20, 1, 60, 60);
+  ArnelifyReceiver receiver(opts);
+  for (const char* mode : {"unread", "read", "eager"}) {
+    const std::string_view label = mode;
+    std::size_t checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      receiver.onBlock(request.data(), request.length());
+      const ArnelifyServerReq& req = receiver.finish();
+      if (label == "unread") {
+        checksum += req.getPath().length();
+        continue;
+      }
+
+      if (label == "read") {
+        checksum += req.getBody().size();
+        continue;
+      }
+
+      Json::Value parsed;
+      Json::CharReaderBuilder reader;
+      std::string errors;
+      std::istringstream iss(std::string(req.getRawBody()));
+      Json::parseFromStream(reader, iss, &parsed, &errors);
+      checksum += parsed.size();
+    }
+
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    if (!checksum) exit(1);
+    std::cout << "body, " << body.length() << " B JSON " << label << ": "
+              << elapsed.count() / iterations * 1e6 << " us/request"
+              << std::endl;
+  }
+}
+
+/* Sends "request" and reads its whole response into "buffer". */
+bool roundTrip(const int& socket, const std::string& request, char* buffer,
+               const std::size_t& bufferSize) {
+  send(socket, request.data(), request.length(), MSG_NOSIGNAL);
+  std::size_t received = 0;
+  while (true) {
+    const ssize_t bytesRead =
+        recv(socket, buffer + received, bufferSize - received, 0);
+    if (bytesRead <= 0) return false;
+    received += bytesRead;
+
+    const char* headersEnd = static_cast<const char*>(
+        memmem(buffer, received, "\r\n\r\n", 4));
+    if (!headersEnd) continue;
+
+    const char* length = static_cast<const char*>(
+        memmem(buffer, headersEnd - buffer, "Content-Length: ", 16));
+    if (!length) return false;
+
+    const std::size_t bodyLength = std::strtoul(length + 16, nullptr, 10);
+    const std::size_t headersLength = headersEnd + 4 - buffer;
+    if (received >= headersLength + bodyLength) return true;
+  }
+}
+
+int connectTo(const int& port) {
+  const int client = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  const bool isConnected =
+      connect(client, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+  if (isConnected) return client;
+
+  close(client);
+  return -1;
+}
+
+/* A running server answering keep-alive requests and short connections.
+   Once the first of them have grown the buffers, the sessions the slab
+   recycles must let requests through without a single allocation. */
+void benchServer(const std::string& ioModel, const int& port,
+                 const int& iterations) {
+  const std::filesystem::path uploadDir =
+      std::filesystem::temp_directory_path() / "arnelify-bench";
+  ArnelifyServerOpts opts(true, 1, "UTF-8", false, true, 1024, 20, 1, 60, 60,
+                          port, 1024, uploadDir.string(), ioModel, 1, 5, 0);
+
+  /* Never freed: its workers keep running until the process exits. */
+  ArnelifyServer* server = new ArnelifyServer(opts);
+  Json::Value json;
+  json["code"] = 200;
+  json["success"] = "Welcome to Arnelify Server";
+  server->setHandler([json](const ArnelifyServerReq& req,
+                            ArnelifyServerRes res) {
+    res->addJson(json);
+    res->end();
+  });
+
+  std::thread([server]() {
+    server->start([](const std::string& message, const bool& isError) {
+      if (isError) std::cout << "Server error: " << message << std::endl;
+    });
+  }).detach();
+
+  int client = -1;
+  while ((client = connectTo(port)) == -1) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  const std::string request = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  char buffer[4096];
+  for (const bool isConnection : {false, true}) {
+    std::size_t allocationsStart = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = -iterations / 10; i < iterations; ++i) {
+      if (!i) {
+        allocationsStart = allocations.load();
+        start = std::chrono::steady_clock::now();
+      }
+
+      if (isConnection) {
+        close(client);
+        client = connectTo(port);
+      }
+
+      if (!roundTrip(client, request, buffer, sizeof(buffer))) {
+        std::cout << "Server round trip failed" << std::endl;
+        exit(1);
+      }
+    }
+
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    const double allocationsTotal = allocations.load() - allocationsStart;
+    const double perRequest = allocationsTotal / iterations;
+    std::cout << "server, " << ioModel << ", "
+              << (isConnection ? "connection per request" : "keep-alive")
+              << ": " << elapsed.count() / iterations * 1e6
+              << " us/request, " << perRequest << " allocations/request"
+              << std::endl;
+
+    /* A reconnecting client can get ahead of the loop closing its last
+       connection, and the slab then grows by a session now and then. A
+       thread model connection starts a thread, which always allocates. */
+    const bool isAllocated = isConnection
+                                 ? ioModel == "epoll" && perRequest > 0.01
+                                 : allocationsTotal > 0;
+    if (isAllocated) {
+      std::cout << "Steady-state requests allocated" << std::endl;
+      exit(1);
+    }
+  }
+
+  close(client);
+}
+
+/* The handler of the watch build on the other side of the FFI: it finds
+   the route first, and only a route that isn't raw asks for the parsed
+   body. "/raw" takes its body raw, "/users" parsed, nothing else exists. */
+const char* handleFfi(const char* cReq) {
+  Json::Value req;
+  Json::CharReaderBuilder reader;
+  std::string errors;
+  std::istringstream iss(cReq);
+  Json::parseFromStream(reader, iss, &req, &errors);
+
+  Json::Value res;
+  const std::string path = req["_state"]["path"].asString();
+  res["code"] = 404;
+  if (path == "/raw") {
+    res["code"] = 200;
+    res["body"] = req["body"];
+  } else if (path == "/users") {
+    const char* cBody = server_get_body();
+    res["code"] = cBody ? 200 : 409;
+    if (cBody) res["body"] = cBody;
+  }
+
+  const std::string serialized = ArnelifyWriter::stringify(res);
+  char* cRes = new char[serialized.length() + 1];
+  std::memcpy(cRes, serialized.c_str(), serialized.length() + 1);
+  return cRes;
+}
+
+/* Requests through the FFI get what the build gives them: a raw route
+   gets its body as received, even when it isn't valid JSON, and only a
+   route that parses the body answers invalid JSON with 409. */
+void checkFfi(const int& port) {
+  Json::Value opts;
+  opts["SERVER_ALLOW_EMPTY_FILES"] = true;
+  opts["SERVER_BLOCK_SIZE_KB"] = 64;
+  opts["SERVER_CHARSET"] = "UTF-8";
+  opts["SERVER_GZIP"] = false;
+  opts["SERVER_GZIP_CACHE_MB"] = 0;
+  opts["SERVER_GZIP_LEVEL"] = 6;
+  opts["SERVER_GZIP_THRESHOLD"] = 96;
+  opts["SERVER_IO_MODEL"] = "epoll";
+  opts["SERVER_KEEP_ALIVE"] = 5;
+  opts["SERVER_KEEP_EXTENSIONS"] = true;
+  opts["SERVER_MAX_FIELDS"] = 1024;
+  opts["SERVER_MAX_FIELDS_SIZE_TOTAL_MB"] = 20;
+  opts["SERVER_MAX_FILES"] = 1;
+  opts["SERVER_MAX_FILES_SIZE_TOTAL_MB"] = 60;
+  opts["SERVER_MAX_FILE_SIZE_MB"] = 60;
+  opts["SERVER_MAX_REQUESTS"] = 1000;
+  opts["SERVER_PORT"] = port;
+  opts["SERVER_QUEUE_LIMIT"] = 1024;
+  opts["SERVER_SLAB_LIMIT"] = 1024;
+  opts["SERVER_THREAD_LIMIT"] = 1;
+  opts["SERVER_UPLOAD_BUFFER_KB"] = 1024;
+  opts["SERVER_UPLOAD_DIR"] =
+      (std::filesystem::temp_directory_path() / "arnelify-bench").string();
+  opts["SERVER_UPLOAD_DIRECT"] = false;
+  opts["SERVER_UPLOAD_PREALLOCATE"] = true;
+  opts["SERVER_WORKERS"] = 1;
+
+  server_create(ArnelifyWriter::stringify(opts).c_str());
+  server_set_handler(handleFfi, 1);
+  std::thread([]() {
+    server_start([](const char* cMessage, const int isError) {
+      if (isError) std::cout << "Server error: " << cMessage << std::endl;
+    });
+  }).detach();
+
+  struct Case {
+    std::string path;
+    const char* type;
+    std::string body;
+    std::string expected;
+  };
+
+  const Case cases[] = {
+      {"/raw", "application/json", "{\"id\":", "200 {\"id\":"},
+      {"/raw", "application/x-www-form-urlencoded", "a=1", "200 a=1"},
+      {"/users", "application/json", "{\"id\":", "409 "},
+      {"/users", "application/json", "{\"id\":42}", "200 {\"id\":42}"},
+      {"/users", "application/x-www-form-urlencoded", "a=1&a=x%20y",
+       "200 {\"a\":[\"1\",\"x y\"]}"},
+      {"/missing", "application/json", "{\"id\":", "404 "}};
+
+  int client = -1;
+  while ((client = connectTo(port)) == -1) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  char buffer[4096];
+  for (const Case& test : cases) {
+    std::string request = "POST " + test.path + " HTTP/1.1\r\nContent-Type: ";
+    request += test.type;
+    request += "\r\nContent-Length: " + std::to_string(test.body.length());
+    request += "\r\n\r\n" + test.body;
+    std::memset(buffer, 0, sizeof(buffer));
+    if (!roundTrip(client, request, buffer, sizeof(buffer) - 1)) {
+      std::cout << "FFI round trip failed for " << test.path << std::endl;
+      exit(1);
+    }
+
+    const std::string response(buffer);
+    const std::string status = response.substr(9, 3);
+    const std::string body = response.substr(response.find("\r\n\r\n") + 4);
+    if (status + " " + body != test.expected) {
+      std::cout << "FFI mismatch for " << test.path << " " << test.body
+                << ": " << status << " " << body << std::endl;
+      exit(1);
+    }
+  }
+
+  close(client);
+}
+
+/* Serializing a handler response into the body, with a writer built per
+   response as the handlers did, against the writer appending in place. */
+void benchJson(const std::string& label, const Json::Value& json,
+               const int& iterations) {
+  std::string body;
+  for (const bool isInPlace : {false, true}) {
+    const std::size_t allocationsStart = allocations.load();
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      if (isInPlace) {
+        ArnelifyWriter::write(json, body);
+      } else {
+        Json::StreamWriterBuilder writer;
+        writer["indentation"] = "";
+        writer["emitUTF8"] = true;
+        body.append(Json::writeString(writer, json));
+      }
+
+      body.clear();
+    }
+
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    const double allocationsTotal = allocations.load() - allocationsStart;
+    std::cout << "json, " << label << ", "
+              << (isInPlace ? "in place" : "writeString") << ": "
+              << elapsed.count() / iterations * 1e6 << " us/response, "
+              << allocationsTotal / iterations << " allocations/response"
+              << std::endl;
+  }
+}
+
+/* One response body through each encoder this build has, at the levels
+   the transmitter derives from the default SERVER_GZIP_LEVEL of 6. */
+template <typename Encoder>
+void benchEncoder(const std::string& label, Encoder& encoder, const int& level,
+                  const std::string& body, const int& iterations) {
+  std::size_t bytesCompressed = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    encoder.begin(level, 65536);
+    encoder.write(body.data(), body.length(), true,
+                  [&](const char*, std::size_t length, bool) {
+                    bytesCompressed += length;
+                    return true;
+                  });
+  }
+
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  std::cout << "  " << label << ": " << elapsed.count() / iterations * 1e6
+            << " us/response, " << bytesCompressed / iterations << " bytes"
+            << std::endl;
+}
+
+void benchEncoders(const std::string& label, const std::string& body,
+                   const int& iterations) {
+  std::cout << "encoders, " << label << ", " << body.length() << " bytes"
+            << std::endl;
+  benchEncoder("gzip", ArnelifyDeflater::get(), 6, body, iterations);
+#ifdef ARNELIFY_HAS_BROTLI
+  benchEncoder("br", ArnelifyBrotli::get(), 5, body, iterations);
+#endif
+#ifdef ARNELIFY_HAS_ZSTD
+  benchEncoder("zstd", ArnelifyZstd::get(), 3, body, iterations);
+#endif
+}
+
+/* File response as it was before sendfile: the file is read through an
+   ifstream into a block and every block is copied to the socket. */
+void sendLegacy(const int& socket, const std::filesystem::path& path,
+                const std::size_t& blockSize) {
+  std::ifstream file(path, std::ios::binary);
+  const std::size_t fileSize = std::filesystem::file_size(path);
+  const std::string headers = "HTTP/1.1 200 OK\r\nContent-Length: " +
+                              std::to_string(fileSize) + "\r\n\r\n";
+  send(socket, headers.data(), headers.length(), 0);
+
+  char* block = new char[blockSize];
+  while (file.read(block, blockSize) || file.gcount() > 0) {
+    send(socket, block, file.gcount(), 0);
+  }
+
+  delete[] block;
+}
+
+/* Loopback pair: "peer" sends, a thread drains the client end. */
+class Loopback final {
+ private:
+  int client;
+  std::thread reader;
+  int server;
+
+ public:
+  int peer;
+  std::size_t received;
+
+  Loopback() : received(0) {
+    this->server = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLen = sizeof(addr);
+    bind(this->server, reinterpret_cast<sockaddr*>(&addr), addrLen);
+    listen(this->server, 1);
+    getsockname(this->server, reinterpret_cast<sockaddr*>(&addr), &addrLen);
+
+    this->client = socket(AF_INET, SOCK_STREAM, 0);
+    connect(this->client, reinterpret_cast<sockaddr*>(&addr), addrLen);
+    this->peer = accept(this->server, nullptr, nullptr);
+    this->reader = std::thread([this]() {
+      char* buffer = new char[262144];
+      ssize_t bytesRead = 0;
+      while ((bytesRead = recv(this->client, buffer, 262144, 0)) > 0) {
+        this->received += bytesRead;
+      }
+
+      delete[] buffer;
+    });
+  }
+
+  /* Waits until everything sent so far has been read. */
+  void finish() {
+    shutdown(this->peer, SHUT_WR);
+    this->reader.join();
+    close(this->peer);
+    close(this->client);
+    close(this->server);
+  }
+};
+
+void benchFile(const std::string& label, const std::size_t& fileSize,
+               const int& iterations) {
+  const std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "arnelify-bench.bin";
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  std::string block(1048576, 0);
+  std::mt19937 rng(7);
+  for (char& c : block) c = static_cast<char>(rng());
+  for (std::size_t i = 0; i < fileSize; i += block.length()) {
+    out.write(block.data(), std::min(block.length(), fileSize - i));
+  }
+
+  out.close();
+
+  for (const bool isLegacy : {true, false}) {
+    Loopback loopback;
+    ArnelifyTransmitterOpts opts(64, "UTF-8", false, "127.0.0.1");
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      if (isLegacy) {
+        sendLegacy(loopback.peer, path, 65536);
+        continue;
+      }
+
+      ArnelifyTransmitter transmitter(loopback.peer, opts);
+      transmitter.setFile(path, true);
+      transmitter.end();
+    }
+
+    loopback.finish();
+    const auto end = std::chrono::steady_clock::now();
+    if (loopback.received < fileSize * iterations) {
+      std::cout << "File response failed: " << loopback.received << " bytes"
+                << std::endl;
+      exit(1);
+    }
+
+    const std::chrono::duration<double> elapsed = end - start;
+    std::cout << "file response, " << label << ", "
+              << (isLegacy ? "ifstream + send" : "sendfile") << ": "
+              << fileSize * iterations / elapsed.count() / 1e9 << " GB/s, "
+              << elapsed.count() / iterations * 1e6 << " us/response"
+              << std::endl;
+  }
+
+  std::filesystem::remove(path);
+}
+
+/* A gzip-encoded text asset, compressed on every hit and from the cache. */
+void benchAsset(const std::size_t& fileSize, const int& iterations) {
+  const std::filesystem::path path =
+      std::filesystem::temp_directory_path() / "arnelify-bench.css";
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  std::mt19937 rng(11);
+  for (std::size_t i = 0; i < fileSize; i += 32) {
+    out << ".c" << rng() % 100000 << "{margin:" << rng() % 64 << "px}\n";
+  }
+
+  out.close();
+
+  for (const bool isCached : {false, true}) {
+    Loopback loopback;
+    ArnelifyCache cache(64 * 1048576);
+    ArnelifyTransmitterOpts opts(64, "UTF-8", true, "127.0.0.1");
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      ArnelifyTransmitter transmitter(loopback.peer, opts,
+                                      isCached ? &cache : nullptr);
+      transmitter.setEncoding("gzip");
+      transmitter.setFile(path, true);
+      transmitter.end();
+    }
+
+    loopback.finish();
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << "gzip asset, " << fileSize / 1024 << " KB, "
+              << (isCached ? "cached" : "compressed per hit") << ": "
+              << elapsed.count() / iterations * 1e6 << " us/response, "
+              << loopback.received / iterations << " bytes" << std::endl;
+  }
+
+  std::filesystem::remove(path);
+}
+
+int main(int argc, char* argv[]) {
+  const int iterations = argc > 1 ? std::stoi(argv[1]) : 200000;
+  std::mt19937 rng(42);
+
+  benchHead(iterations);
+  benchRequest(iterations);
+  benchBody(iterations / 10);
+  benchQuery(iterations / 10);
+  benchFields(iterations);
+  benchServer("epoll", 3151, 20000);
+  benchServer("thread", 3152, 20000);
+  checkScanner(rng);
+  checkMultipart(rng);
+  checkRange();
+  checkEncoding();
+  checkBody();
+  checkQuery(rng);
+  checkFields();
+  checkWriter(rng);
+  checkFfi(3153);
+
+  /* A haystack the size of one read block, as the receiver scans it. */
+  std::string text(64 * 1024, 'a');
+  for (char& c : text) c = 'a' + rng() % 26;
+  text += "\r\n\r\n";
+  benchScanner("CRLFCRLF in text", text, "\r\n\r\n");
+
+  std::string binary(64 * 1024, 0);
+  for (char& c : binary) c = static_cast<char>(rng());
+  const std::string boundary = "\r\n------WebKitFormBoundary7MA4YWxkTrZu0gW";
+  binary += boundary;
+  benchScanner("boundary in binary", binary, boundary);
+
+  benchMultipart(rng, 64 * 1048576);
+
+  std::string json = "{\"items\":[";
+  while (json.length() < 1048576) {
+    json += "{\"id\":" + std::to_string(rng() % 100000) +
+            ",\"name\":\"item\",\"isActive\":true},";
+  }
+
+  json.back() = ']';
+  json += "}";
+
+  Json::Value response;
+  response["code"] = 200;
+  response["success"] = "Welcome to Arnelify Server";
+  benchJson("welcome", response, 200000);
+
+  Json::Value items;
+  Json::CharReaderBuilder reader;
+  std::istringstream stream(json.substr(0, json.rfind("},", 16384) + 1) +
+                            "]}");
+  Json::parseFromStream(reader, stream, &items, nullptr);
+  benchJson(std::to_string(items["items"].size()) + " items", items, 2000);
+  benchGzip("1 KB JSON", json.substr(0, 1024), 20000);
+  benchGzip("1 MB JSON", json, 50);
+  benchEncoders("1 KB JSON", json.substr(0, 1024), 20000);
+  benchEncoders("64 KB JSON", json.substr(0, 65536), 500);
+  benchEncoders("1 MB JSON", json, 50);
+
+  benchAsset(100 * 1024, 2000);
+  benchFile("1 KB", 1024, 10000);
+  benchFile("1 MB", 1048576, 200);
+  benchFile("1 GB", 1073741824, 2);
+  return 0;
+}
+
+#endif
\ No newline at end of file
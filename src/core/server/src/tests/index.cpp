@@ -14,25 +14,42 @@ int main(int argc, char* argv[]) {
   opts["SERVER_BLOCK_SIZE_KB"] = 64;
   opts["SERVER_CHARSET"] = "UTF-8";
   opts["SERVER_GZIP"] = true;
+  opts["SERVER_GZIP_CACHE_MB"] = 64;
+  opts["SERVER_GZIP_LEVEL"] = 6;
+  opts["SERVER_GZIP_THRESHOLD"] = 96;
+  opts["SERVER_IO_MODEL"] = "epoll";
+  opts["SERVER_KEEP_ALIVE"] = 5;
   opts["SERVER_KEEP_EXTENSIONS"] = true;
   opts["SERVER_MAX_FIELDS"] = 1024;
   opts["SERVER_MAX_FIELDS_SIZE_TOTAL_MB"] = 20;
   opts["SERVER_MAX_FILES"] = 1;
   opts["SERVER_MAX_FILES_SIZE_TOTAL_MB"] = 60;
   opts["SERVER_MAX_FILE_SIZE_MB"] = 60;
+  opts["SERVER_MAX_REQUESTS"] = 1000;
   opts["SERVER_PORT"] = 3001;
   opts["SERVER_QUEUE_LIMIT"] = 1024;
+  opts["SERVER_SLAB_LIMIT"] = 1024;
+  opts["SERVER_THREAD_LIMIT"] = 0;
+  opts["SERVER_UPLOAD_BUFFER_KB"] = 1024;
+  opts["SERVER_UPLOAD_DIRECT"] = false;
+  opts["SERVER_UPLOAD_PREALLOCATE"] = true;
+  opts["SERVER_WORKERS"] = 1;
   opts["SERVER_UPLOAD_PATH"] = "./src/storage/upload";
 
   ArnelifyServer server(opts);
 
-  server.setHandler([](const ArnelifyServerReq& req, ArnelifyServerRes& res) {
-    Json::StreamWriterBuilder writer;
-    writer["indentation"] = "";
-    writer["emitUTF8"] = true;
+  server.setHandler([&server](const ArnelifyServerReq& req,
+                             ArnelifyServerRes& res) {
+    Json::Value json = req;
+    const bool isValid = server.getBody(json["body"]);
+    if (!isValid) {
+      json = Json::objectValue;
+      json["code"] = 409;
+      json["error"] = "The body contains invalid JSON.";
+    }
 
-    res.setCode(200);
-    res.addBody(Json::writeString(writer, req));
+    res.setCode(isValid ? 200 : 409);
+    res.addJson(json);
     res.end();
   });
   
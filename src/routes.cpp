@@ -2,12 +2,22 @@
 #define ROUTES_CPP
 
 #include "broker/src/index.cpp"
+#include "router/src/cpp/table/index.cpp"
 #include "router/src/index.cpp"
 
 #include "middleware/test.cpp"
 #include "services/first.cpp"
 #include "services/second.cpp"
 
+/* Routes known at build time. Their static patterns are served from the
+   compiled table, the rest through the dynamic router. */
+constexpr StaticRoute ROUTES[] = {
+    {"GET", "/", [](const Ctx& ctx) -> Json::Value {
+       return broker->call("first.welcome", ctx["params"]);
+     }}};
+
+constexpr ArnelifyRouteTable routeTable(ROUTES);
+
 void routes(ArnelifyRouter& router) {
   broker->subscribe("second.welcome", [](const Ctx& ctx) -> Json::Value {
     Second second;
@@ -20,9 +30,7 @@ void routes(ArnelifyRouter& router) {
     return first.welcome(newCtx);
   });
 
-  router.get("/", [](const Ctx& ctx) -> Json::Value {
-    return broker->call("first.welcome", ctx["params"]);
-  });
+  routeTable.install(router);
 }
 
 #endif
\ No newline at end of file
@@ -33,49 +33,89 @@ int main(int argc, char* argv[]) {
   std::stoi(env.SERVER_MAX_FILE_SIZE_MB),
   std::stoi(env.SERVER_PORT),
   std::stoi(env.SERVER_QUEUE_LIMIT),
-  "./src/storage/upload");
+  "./src/storage/upload",
+  env.SERVER_IO_MODEL,
+  std::stoi(env.SERVER_THREAD_LIMIT),
+  std::stoi(env.SERVER_KEEP_ALIVE),
+  std::stoi(env.SERVER_MAX_REQUESTS),
+  std::stoi(env.SERVER_WORKERS),
+  std::stoi(env.SERVER_UPLOAD_BUFFER_KB),
+  env.SERVER_UPLOAD_DIRECT == "true",
+  env.SERVER_UPLOAD_PREALLOCATE == "true",
+  std::stoi(env.SERVER_GZIP_LEVEL),
+  std::stoi(env.SERVER_GZIP_THRESHOLD),
+  std::stoi(env.SERVER_GZIP_CACHE_MB),
+  std::stoi(env.SERVER_SLAB_LIMIT));
 
   ArnelifyServer server(opts);
+  routeCache->setCapacity(std::stoul(env.ROUTER_CACHE_MB) * 1048576);
 
   server.setHandler(
       [&router](const ArnelifyServerReq& req, ArnelifyServerRes res) {
-        Json::StreamWriterBuilder writer;
-        writer["indentation"] = "";
-        writer["emitUTF8"] = true;
-
-        const std::string method = req["_state"]["method"].asString();
-        const std::string path = req["_state"]["path"].asString();
-        const std::optional<Route> routeOpt = router.find(method, path);
-        if (!routeOpt) {
+        const std::string method(req.getMethod());
+        const std::string path(req.getPath());
+        const StaticRoute* staticRoute = routeTable.find(method, path);
+        std::optional<Route> routeOpt;
+        if (!staticRoute) routeOpt = router.find(method, path);
+        if (!staticRoute && !routeOpt) {
           Json::Value json;
           json["code"] = 404;
           json["error"] = "Not found.";
 
           res->setCode(404);
-          res->addBody(Json::writeString(writer, json));
+          res->addJson(json);
           res->end();
           return;
         }
 
-        res->setCode(200);
-        const Route& route = *routeOpt;
-        const std::optional<Controller> controllerOpt =
-            router.getController(route.id);
-        const Controller& controller = *controllerOpt;
-
-        Ctx ctx;
-        ctx["params"] = req;
-        const Json::Value response = controller(ctx);
-        const bool isObject = response.isObject();
-        if (!isObject) {
-          res->addBody(Json::writeString(writer, response));
+        const bool isRaw = staticRoute ? staticRoute->isRaw : routeOpt->isRaw;
+        const bool isInvalid = !isRaw && !req.isValidBody();
+        if (isInvalid) {
+          Json::Value json;
+          json["code"] = 409;
+          json["error"] = "The body contains invalid JSON.";
+
+          res->setCode(409);
+          res->addJson(json);
+          res->end();
+          return;
+        }
+
+        const RouteCache* cache = staticRoute
+                                      ? staticRoute->cache
+                                      : router.getCache(routeOpt->id);
+        const bool isCached = cache && method == "GET";
+        const auto run = [&]() -> Json::Value {
+          Ctx ctx;
+          ctx["params"] = req.toJson(isRaw);
+          const Controller controller =
+              staticRoute ? Controller(staticRoute->controller)
+                          : *router.getController(routeOpt->id);
+          return controller(ctx);
+        };
+
+        if (!isCached) {
+          const Json::Value response = run();
+          res->setCode(ArnelifyRouteCache::getCode(response));
+          res->addJson(response);
           res->end();
           return;
         }
 
-        const bool hasCode = response.isMember("code") && response.isInt();
-        if (hasCode) res->setCode(response["code"].asInt());
-        res->addBody(Json::writeString(writer, response));
+        /* Only successful responses are cached. */
+        thread_local std::string key;
+        ArnelifyRouteCache::setKey(key, *cache, req);
+        const ArnelifyRouteCache::Bytes cached =
+            routeCache->fetch(key, *cache, [&run]() {
+              const Json::Value response = run();
+              ArnelifyRouteCache::Response rendered{
+                  ArnelifyRouteCache::getCode(response), ""};
+              ArnelifyWriter::write(response, rendered.body);
+              return rendered;
+            });
+
+        res->setCode(cached->code);
+        res->addBody(cached->body);
         res->end();
       });
 
@@ -23,6 +23,11 @@ int main(int argc, char* argv[]) {
   opts["SERVER_BLOCK_SIZE_KB"] = std::stoi(env.SERVER_BLOCK_SIZE_KB);
   opts["SERVER_CHARSET"] = env.SERVER_CHARSET;
   opts["SERVER_GZIP"] = env.SERVER_GZIP == "true";
+  opts["SERVER_GZIP_CACHE_MB"] = std::stoi(env.SERVER_GZIP_CACHE_MB);
+  opts["SERVER_GZIP_LEVEL"] = std::stoi(env.SERVER_GZIP_LEVEL);
+  opts["SERVER_GZIP_THRESHOLD"] = std::stoi(env.SERVER_GZIP_THRESHOLD);
+  opts["SERVER_IO_MODEL"] = env.SERVER_IO_MODEL;
+  opts["SERVER_KEEP_ALIVE"] = std::stoi(env.SERVER_KEEP_ALIVE);
   opts["SERVER_KEEP_EXTENSIONS"] = env.SERVER_KEEP_EXTENSIONS == "true";
   opts["SERVER_MAX_FIELDS"] = std::stoi(env.SERVER_MAX_FIELDS);
   opts["SERVER_MAX_FIELDS_SIZE_TOTAL_MB"] =
@@ -31,17 +36,22 @@ int main(int argc, char* argv[]) {
   opts["SERVER_MAX_FILES_SIZE_TOTAL_MB"] =
       std::stoi(env.SERVER_MAX_FILES_SIZE_TOTAL_MB);
   opts["SERVER_MAX_FILE_SIZE_MB"] = std::stoi(env.SERVER_MAX_FILE_SIZE_MB);
+  opts["SERVER_MAX_REQUESTS"] = std::stoi(env.SERVER_MAX_REQUESTS);
   opts["SERVER_PORT"] = std::stoi(env.SERVER_PORT);
   opts["SERVER_QUEUE_LIMIT"] = std::stoi(env.SERVER_QUEUE_LIMIT);
+  opts["SERVER_SLAB_LIMIT"] = std::stoi(env.SERVER_SLAB_LIMIT);
+  opts["SERVER_THREAD_LIMIT"] = std::stoi(env.SERVER_THREAD_LIMIT);
+  opts["SERVER_UPLOAD_BUFFER_KB"] = std::stoi(env.SERVER_UPLOAD_BUFFER_KB);
+  opts["SERVER_UPLOAD_DIRECT"] = env.SERVER_UPLOAD_DIRECT == "true";
+  opts["SERVER_UPLOAD_PREALLOCATE"] =
+      env.SERVER_UPLOAD_PREALLOCATE == "true";
+  opts["SERVER_WORKERS"] = std::stoi(env.SERVER_WORKERS);
   opts["SERVER_UPLOAD_PATH"] = "./src/storage/upload";
   ArnelifyServer server(opts);
 
   server.setHandler(
-      [&router](const ArnelifyServerReq& req, ArnelifyServerRes& res) {
-        Json::StreamWriterBuilder writer;
-        writer["indentation"] = "";
-        writer["emitUTF8"] = true;
-
+      [&router, &server](const ArnelifyServerReq& req,
+                         ArnelifyServerRes& res) {
         const std::string method = req["_state"]["method"].asString();
         const std::string path = req["_state"]["path"].asString();
         const std::optional<Route> routeOpt = router.find(method, path);
@@ -51,30 +61,33 @@ int main(int argc, char* argv[]) {
           json["error"] = "Not found.";
 
           res.setCode(404);
-          res.addBody(Json::writeString(writer, json));
+          res.addJson(json);
           res.end();
           return;
         }
 
-        res.setCode(200);
         const Route& route = *routeOpt;
-        const std::optional<Controller> controllerOpt =
-            router.getController(route.id);
-        const Controller& controller = *controllerOpt;
-
         Ctx ctx;
         ctx["params"] = req;
-        const Json::Value response = controller(ctx);
-        const bool isObject = response.isObject();
-        if (!isObject) {
-          res.addBody(Json::writeString(writer, response));
+        const bool isInvalid =
+            !route.isRaw && !server.getBody(ctx["params"]["body"]);
+        if (isInvalid) {
+          Json::Value json;
+          json["code"] = 409;
+          json["error"] = "The body contains invalid JSON.";
+
+          res.setCode(409);
+          res.addJson(json);
           res.end();
           return;
         }
 
-        const bool hasCode = response.isMember("code") && response.isInt();
-        if (hasCode) res.setCode(response["code"].asInt());
-        res.addBody(Json::writeString(writer, response));
+        const std::optional<Controller> controllerOpt =
+            router.getController(route.id);
+        const Controller& controller = *controllerOpt;
+        const Json::Value response = controller(ctx);
+        res.setCode(ArnelifyRouteCache::getCode(response));
+        res.addJson(response);
         res.end();
       });
 